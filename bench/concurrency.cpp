@@ -0,0 +1,108 @@
+/**
+ * murify: Efficient in-memory compression for URLs
+ * @see https://github.com/hunyadi/murify
+ *
+ * Copyright (c) 2024 Levente Hunyadi
+ *
+ * This work is licensed under the terms of the MIT license.
+ * For a copy, see <https://opensource.org/licenses/MIT>.
+ */
+
+#include <murify/compactor.hpp>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * Measures how compaction throughput scales with the number of threads sharing a single compactor.
+ *
+ * Usage: murify-bench-concurrency [max_threads] [url_count]
+ */
+
+static std::vector<std::string> generate_urls(std::size_t count)
+{
+    std::vector<std::string> urls;
+    urls.reserve(count);
+    std::uint64_t state = 0x9e3779b97f4a7c15ull;
+    auto next = [&state](std::uint64_t bound) {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        return state % bound;
+    };
+    for (std::size_t k = 0; k < count; ++k) {
+        std::string url = "https://tenant" + std::to_string(next(5000)) + ".example.com/api/v" + std::to_string(next(3));
+        url += "/collection" + std::to_string(next(200)) + "/" + std::to_string(next(1000000));
+        url += "/resource-" + std::to_string(next(100000)) + "?lang=en&sort=name&page=" + std::to_string(next(100));
+        urls.push_back(std::move(url));
+    }
+    return urls;
+}
+
+template<typename Fn>
+static double run(std::size_t thread_count, std::size_t url_count, Fn&& fn)
+{
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (std::size_t t = 0; t < thread_count; ++t) {
+        threads.emplace_back([&fn, t, thread_count, url_count]() {
+            std::basic_string<std::byte> buf;
+            for (std::size_t k = t; k < url_count; k += thread_count) {
+                buf.clear();
+                fn(k, buf);
+            }
+        });
+    }
+    for (auto&& thread : threads) {
+        thread.join();
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return url_count / elapsed.count();
+}
+
+int main(int argc, char* argv[])
+{
+    std::size_t max_threads = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : std::thread::hardware_concurrency();
+    std::size_t url_count = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 1000000;
+    if (max_threads == 0) {
+        max_threads = 1;
+    }
+
+    auto urls = generate_urls(url_count);
+    std::cout << "threads\tmutex (URL/s)\tconcurrent cold (URL/s)\tconcurrent warm (URL/s)\tspeedup (warm)" << std::endl;
+
+    double baseline = 0;
+    for (std::size_t thread_count = 1; thread_count <= max_threads; thread_count *= 2) {
+        // single compactor serialized behind a mutex
+        murify::URLCompactor serial;
+        std::mutex mutex;
+        double locked = run(thread_count, url_count, [&](std::size_t k, std::basic_string<std::byte>& buf) {
+            std::lock_guard<std::mutex> lock(mutex);
+            murify::byte_string_sink sink(buf);
+            serial.compact_into(urls[k], sink);
+        });
+
+        // shared compactor with concurrent store, first with an empty then with a populated dictionary
+        murify::ConcurrentURLCompactor shared;
+        auto compact = [&](std::size_t k, std::basic_string<std::byte>& buf) {
+            murify::byte_string_sink sink(buf);
+            shared.compact_into(urls[k], sink);
+        };
+        double cold = run(thread_count, url_count, compact);
+        double warm = run(thread_count, url_count, compact);
+        if (thread_count == 1) {
+            baseline = warm;
+        }
+
+        std::cout << thread_count << "\t" << static_cast<std::uint64_t>(locked) << "\t" << static_cast<std::uint64_t>(cold) << "\t" << static_cast<std::uint64_t>(warm) << "\t" << warm / baseline << std::endl;
+
+        if (thread_count < max_threads && 2 * thread_count > max_threads) {
+            thread_count = max_threads / 2;
+        }
+    }
+    return 0;
+}
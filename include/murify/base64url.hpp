@@ -9,6 +9,8 @@
  */
 
 #pragma once
+#include "detail/base64_simd.hpp"
+
 #include <string>
 #include <string_view>
 #include <cstddef>
@@ -17,29 +19,39 @@ namespace murify
 {
     struct base64
     {
-        static bool encode(const std::basic_string_view<std::byte>& input, std::string& output)
+        /** Number of characters base64url-encoding a sequence of bytes produces (without padding). */
+        static constexpr std::size_t encoded_size(std::size_t length)
+        {
+            return 4 * (length / 3) + (length % 3 > 0 ? length % 3 + 1 : 0);
+        }
+
+        /** Number of bytes base64url-decoding a sequence of characters produces (without padding). */
+        static constexpr std::size_t decoded_size(std::size_t length)
+        {
+            return 3 * (length / 4) + (length % 4 > 1 ? length % 4 - 1 : 0);
+        }
+
+        /**
+         * Encodes a sequence of bytes into a buffer.
+         *
+         * Long inputs are encoded with vectorized kernels where the processor supports them, with output identical to
+         * the scalar code.
+         *
+         * @param input The bytes to encode.
+         * @param output A buffer that holds at least `encoded_size(input.size())` characters.
+         */
+        static void encode(const std::basic_string_view<std::byte>& input, char* output)
         {
-            static constexpr char encoding_table[] = {
-                'A', 'B', 'C', 'D', 'E', 'F', 'G', 'H', 'I', 'J', 'K', 'L', 'M',
-                'N', 'O', 'P', 'Q', 'R', 'S', 'T', 'U', 'V', 'W', 'X', 'Y', 'Z',
-                'a', 'b', 'c', 'd', 'e', 'f', 'g', 'h', 'i', 'j', 'k', 'l', 'm',
-                'n', 'o', 'p', 'q', 'r', 's', 't', 'u', 'v', 'w', 'x', 'y', 'z',
-                '0', '1', '2', '3', '4', '5', '6', '7', '8', '9', '-', '_' };
-
-            std::size_t in_len = input.size();
+            std::size_t i = detail::base64_simd::encode(input.data(), input.size(), output);
+            std::size_t in_len = input.size() - i;
             std::size_t triplets = in_len / 3;
             std::size_t spare = in_len % 3;
-            std::size_t out_len = (4 * triplets) + (spare > 0 ? spare + 1 : 0);
 
-            output.clear();
-            output.resize(out_len);
-
-            char* p = output.data();
+            char* p = output + i / 3 * 4;
             unsigned a;
             unsigned b;
             unsigned c;
 
-            std::size_t i = 0;
             for (std::size_t k = 0; k < triplets; i += 3, ++k) {
                 a = static_cast<unsigned>(input[i]);
                 b = static_cast<unsigned>(input[i + 1]);
@@ -65,7 +77,13 @@ namespace murify
             default:  // case 0:
                 break;
             }
+        }
 
+        static bool encode(const std::basic_string_view<std::byte>& input, std::string& output)
+        {
+            output.clear();
+            output.resize(encoded_size(input.size()));
+            encode(input, output.data());
             return true;
         }
 
@@ -86,26 +104,18 @@ namespace murify
             return encode(std::basic_string_view<std::byte>(input.data(), input.size()));
         }
 
-        static bool decode(const std::string_view& input, std::basic_string<std::byte>& output)
+        /**
+         * Decodes a sequence of characters into a buffer.
+         *
+         * Long inputs are validated and decoded with vectorized kernels where the processor supports them, with output
+         * identical to the scalar code.
+         *
+         * @param input The characters to decode.
+         * @param output A buffer that holds at least `decoded_size(input.size())` bytes.
+         * @return False if the input is not valid base64url, in which case the contents of the buffer are unspecified.
+         */
+        static bool decode(const std::string_view& input, std::byte* output)
         {
-            static constexpr unsigned char decoding_table[] = {
-                64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64,
-                64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64,
-                64, 64, 64, 64, 64, 64, 64, 64, 64, 62, 64, 64, 52, 53, 54, 55, 56, 57,
-                58, 59, 60, 61, 64, 64, 64, 64, 64, 64, 64,  0,  1,  2,  3,  4,  5,  6,
-                 7,  8,  9, 10, 11, 12, 13, 14, 15, 16, 17, 18, 19, 20, 21, 22, 23, 24,
-                25, 64, 64, 64, 64, 63, 64, 26, 27, 28, 29, 30, 31, 32, 33, 34, 35, 36,
-                37, 38, 39, 40, 41, 42, 43, 44, 45, 46, 47, 48, 49, 50, 51, 64, 64, 64,
-                64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64,
-                64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64,
-                64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64,
-                64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64,
-                64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64,
-                64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64,
-                64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64,
-                64, 64, 64, 64 };
-
-            std::size_t quadruplets = input.size() / 4;
             std::size_t spare = 0;
             if (input.size() % 4 == 3) {
                 spare = 2;
@@ -115,15 +125,19 @@ namespace murify
                 return false;
             }
 
-            output.resize(3 * quadruplets + spare);
-            std::byte* p = output.data();
+            bool valid;
+            std::size_t i = detail::base64_simd::decode(input.data(), input.size(), output, valid);
+            if (!valid) {
+                return false;
+            }
+            std::size_t quadruplets = (input.size() - i) / 4;
+            std::byte* p = output + i / 4 * 3;
 
-            std::size_t i = 0;
             for (std::size_t k = 0; k < quadruplets; i += 4, ++k) {
-                unsigned int a = decoding_table[static_cast<int>(input[i])];
-                unsigned int b = decoding_table[static_cast<int>(input[i + 1])];
-                unsigned int c = decoding_table[static_cast<int>(input[i + 2])];
-                unsigned int d = decoding_table[static_cast<int>(input[i + 3])];
+                unsigned int a = decoding_table[static_cast<unsigned char>(input[i])];
+                unsigned int b = decoding_table[static_cast<unsigned char>(input[i + 1])];
+                unsigned int c = decoding_table[static_cast<unsigned char>(input[i + 2])];
+                unsigned int d = decoding_table[static_cast<unsigned char>(input[i + 3])];
                 if (((a | b | c | d) & 64) != 0) {
                     return false;
                 }
@@ -137,9 +151,9 @@ namespace murify
             switch (spare) {
             case 2:
             {
-                unsigned int a = decoding_table[static_cast<int>(input[i])];
-                unsigned int b = decoding_table[static_cast<int>(input[i + 1])];
-                unsigned int c = decoding_table[static_cast<int>(input[i + 2])];
+                unsigned int a = decoding_table[static_cast<unsigned char>(input[i])];
+                unsigned int b = decoding_table[static_cast<unsigned char>(input[i + 1])];
+                unsigned int c = decoding_table[static_cast<unsigned char>(input[i + 2])];
                 if (((a | b | c) & 64) != 0) {
                     return false;
                 }
@@ -151,8 +165,8 @@ namespace murify
             break;
             case 1:
             {
-                unsigned int a = decoding_table[static_cast<int>(input[i])];
-                unsigned int b = decoding_table[static_cast<int>(input[i + 1])];
+                unsigned int a = decoding_table[static_cast<unsigned char>(input[i])];
+                unsigned int b = decoding_table[static_cast<unsigned char>(input[i + 1])];
                 if (((a | b) & 64) != 0) {
                     return false;
                 }
@@ -169,9 +183,61 @@ namespace murify
             return true;
         }
 
+        static bool decode(const std::string_view& input, std::basic_string<std::byte>& output)
+        {
+            if (input.size() % 4 == 1) {
+                return false;
+            }
+            output.resize(decoded_size(input.size()));
+            return decode(input, output.data());
+        }
+
         static bool decode(const std::string& input, std::basic_string<std::byte>& output)
         {
             return decode(std::string_view(input.data(), input.size()), output);
         }
+
+        /** Checks whether a sequence of characters is valid base64url, without decoding it. */
+        static bool validate(const std::string_view& input)
+        {
+            if (input.size() % 4 == 1) {
+                return false;
+            }
+            bool valid;
+            std::size_t i = detail::base64_simd::validate(input.data(), input.size(), valid);
+            if (!valid) {
+                return false;
+            }
+            unsigned int acc = 0;
+            for (; i < input.size(); ++i) {
+                acc |= decoding_table[static_cast<unsigned char>(input[i])];
+            }
+            return (acc & 64) == 0;
+        }
+
+    private:
+        static constexpr char encoding_table[] = {
+            'A', 'B', 'C', 'D', 'E', 'F', 'G', 'H', 'I', 'J', 'K', 'L', 'M',
+            'N', 'O', 'P', 'Q', 'R', 'S', 'T', 'U', 'V', 'W', 'X', 'Y', 'Z',
+            'a', 'b', 'c', 'd', 'e', 'f', 'g', 'h', 'i', 'j', 'k', 'l', 'm',
+            'n', 'o', 'p', 'q', 'r', 's', 't', 'u', 'v', 'w', 'x', 'y', 'z',
+            '0', '1', '2', '3', '4', '5', '6', '7', '8', '9', '-', '_' };
+
+        static constexpr unsigned char decoding_table[256] = {
+            64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64,
+            64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64,
+            64, 64, 64, 64, 64, 64, 64, 64, 64, 62, 64, 64, 52, 53, 54, 55, 56, 57,
+            58, 59, 60, 61, 64, 64, 64, 64, 64, 64, 64,  0,  1,  2,  3,  4,  5,  6,
+             7,  8,  9, 10, 11, 12, 13, 14, 15, 16, 17, 18, 19, 20, 21, 22, 23, 24,
+            25, 64, 64, 64, 64, 63, 64, 26, 27, 28, 29, 30, 31, 32, 33, 34, 35, 36,
+            37, 38, 39, 40, 41, 42, 43, 44, 45, 46, 47, 48, 49, 50, 51, 64, 64, 64,
+            64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64,
+            64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64,
+            64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64,
+            64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64,
+            64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64,
+            64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64,
+            64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64,
+            64, 64, 64, 64 };
     };
 }
@@ -0,0 +1,136 @@
+/**
+ * murify: Efficient in-memory compression for URLs
+ * @see https://github.com/hunyadi/murify
+ *
+ * Copyright (c) 2024 Levente Hunyadi
+ *
+ * This work is licensed under the terms of the MIT license.
+ * For a copy, see <https://opensource.org/licenses/MIT>.
+ */
+
+#pragma once
+#include "sink.hpp"
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <stdexcept>
+#include <cstddef>
+#include <cstdint>
+
+namespace murify
+{
+    /**
+     * A sequence of compact representations stored back to back in a single contiguous buffer.
+     *
+     * Item `i` spans the bytes between offsets `i` and `i+1`, such that each item costs 4 bytes of overhead rather
+     * than a heap allocation and a string object of its own. Offsets are 32-bit, which caps a batch at 4 GiB.
+     */
+    struct batch
+    {
+        batch()
+            : _offsets(1, 0)
+        {
+        }
+
+        /** Number of items in the batch. */
+        std::size_t size() const
+        {
+            return _offsets.size() - 1;
+        }
+
+        bool empty() const
+        {
+            return _offsets.size() == 1;
+        }
+
+        /** The compact representation of the item with the given index. */
+        std::basic_string_view<std::byte> operator[](std::size_t index) const
+        {
+            return std::basic_string_view<std::byte>(_data.data() + _offsets[index], _offsets[index + 1] - _offsets[index]);
+        }
+
+        /** The compact representations of all items back to back. */
+        std::basic_string_view<std::byte> data() const
+        {
+            return std::basic_string_view<std::byte>(_data.data(), _data.size());
+        }
+
+        /** Offsets of items into the buffer, followed by the total size of the buffer. */
+        const std::vector<std::uint32_t>& offsets() const
+        {
+            return _offsets;
+        }
+
+        /** Number of bytes the batch takes in memory. */
+        std::size_t memory_size() const
+        {
+            return _data.capacity() + _offsets.capacity() * sizeof(std::uint32_t);
+        }
+
+        /** Reserves space for items and bytes. */
+        void reserve(std::size_t count, std::size_t bytes)
+        {
+            _offsets.reserve(count + 1);
+            _data.reserve(bytes);
+        }
+
+        /** Releases unused capacity. */
+        void shrink_to_fit()
+        {
+            _offsets.shrink_to_fit();
+            _data.shrink_to_fit();
+        }
+
+        void clear()
+        {
+            _offsets.assign(1, 0);
+            _data.clear();
+        }
+
+        /** Appends an item with the given compact representation. */
+        void push_back(const std::basic_string_view<std::byte>& item)
+        {
+            emplace_back([&item](byte_string_sink& sink) {
+                sink.append(item.data(), item.size());
+            });
+        }
+
+        /** Appends an item whose compact representation a function writes into a sink directly. */
+        template<typename Write>
+        void emplace_back(Write&& write)
+        {
+            // bytes of an item that has not been recorded are discarded
+            std::size_t start = _data.size();
+            try {
+                byte_string_sink sink(_data);
+                write(sink);
+                if (_data.size() > 0xffffffffu) {
+                    throw std::length_error("batch size exceeds 4 GiB");
+                }
+                _offsets.push_back(static_cast<std::uint32_t>(_data.size()));
+            } catch (...) {
+                _data.resize(start);
+                throw;
+            }
+        }
+
+        /** Appends all items of another batch. */
+        void append(const batch& other)
+        {
+            if (_data.size() + other._data.size() > 0xffffffffu) {
+                throw std::length_error("batch size exceeds 4 GiB");
+            }
+            std::uint32_t base = static_cast<std::uint32_t>(_data.size());
+            _data.append(other._data);
+            _offsets.reserve(_offsets.size() + other.size());
+            for (std::size_t k = 1; k < other._offsets.size(); ++k) {
+                _offsets.push_back(base + other._offsets[k]);
+            }
+        }
+
+    private:
+        std::vector<std::uint32_t> _offsets;
+        std::basic_string<std::byte> _data;
+    };
+}
@@ -10,9 +10,20 @@
 
 #pragma once
 #include "base64url.hpp"
+#include "batch.hpp"
 #include "interned_string.hpp"
+#include "concurrent_interned_store.hpp"
+#include "frozen_interned_store.hpp"
+#include "sink.hpp"
+#include "detail/builtin_dictionary.hpp"
+#include "detail/classify.hpp"
+#include "detail/datetime.hpp"
 #include "detail/header.hpp"
+#include "detail/hex.hpp"
 #include "detail/integers.hpp"
+#include "detail/ip.hpp"
+#include "detail/number.hpp"
+#include "detail/percent.hpp"
 #include "detail/strings.hpp"
 
 #include <string>
@@ -20,16 +31,117 @@
 #include <vector>
 #include <charconv>
 #include <algorithm>
+#include <array>
+#include <type_traits>
 #include <stdexcept>
 #include <cstddef>
 #include <cstdint>
 
 namespace murify
 {
+    namespace detail
+    {
+        /**
+         * Stands in for a store while an encoding that may be discarded is measured.
+         *
+         * Strings are not added to the underlying store, and every string that is (or would be) interned gets the
+         * ordinal zero. The size of the encoding thus does not depend on ordinals, which makes the decision whether
+         * to keep it identical however many strings the store holds, e.g. in parallel compaction.
+         */
+        template<typename Store>
+        struct sizing_store
+        {
+            constexpr static bool read_only = std::remove_const_t<Store>::read_only;
+
+            explicit sizing_store(Store& store)
+                : _store(store)
+            {
+            }
+
+            bool find(const std::string_view& str, interned_string& s) const
+            {
+                if (!_store.find(str, s)) {
+                    return false;
+                }
+                s = interned_string(0);
+                return true;
+            }
+
+            interned_string intern(const std::string_view&)
+            {
+                return interned_string(0);
+            }
+
+        private:
+            Store& _store;
+        };
+
+        template<typename Store>
+        struct is_sizing_store : std::false_type
+        {
+        };
+
+        template<typename Store>
+        struct is_sizing_store<sizing_store<Store>> : std::true_type
+        {
+        };
+    }
+
     struct BaseTokenizer
     {
         static std::vector<std::string_view> split(const std::string_view& str);
         static std::string join(const std::vector<std::string>& parts);
+
+        /** Number of parts `split` would produce. */
+        static std::size_t count(const std::string_view& str);
+
+        /** Invokes a function on each part `split` would produce, without allocating storage for them. */
+        template<typename Fn>
+        static void for_each(const std::string_view& str, Fn&& fn);
+
+        /** Writes the separator that `join` would insert in front of the part with the given index. */
+        template<typename Output>
+        static void separate(Output& out, std::size_t index);
+
+        /**
+         * True if the tokenizer lays out the compact representation itself with static member functions `compact` and
+         * `expand`, rather than as a part count followed by parts.
+         */
+        constexpr static bool structured = false;
+
+        /**
+         * Dictionaries the tokenizer keeps in the compactor besides the store of interned strings, e.g. dictionaries
+         * scoped to a context. Tokenizers that intern all parts in the store of the compactor keep none.
+         */
+        template<typename Store>
+        struct context_type
+        {
+            context_type() = default;
+
+            /** Takes a snapshot of the dictionaries of another compactor. */
+            template<typename Other>
+            explicit context_type(const Other&)
+            {
+            }
+
+            /** Adds the strings of the dictionaries of another compactor, in the order they were added. */
+            template<typename Other>
+            void merge(const Other&)
+            {
+            }
+
+            /** Invokes a function on each `context_store`, e.g. to save or load dictionaries. */
+            template<typename Fn>
+            void for_each(Fn&&) const
+            {
+            }
+
+            /** Invokes a function on each `context_store`, e.g. to save or load dictionaries. */
+            template<typename Fn>
+            void for_each(Fn&&)
+            {
+            }
+        };
     };
 
     /**
@@ -41,16 +153,38 @@ namespace murify
      * 0 1  0 0  1  w w w  --> string of size expressed in width w, followed by characters
      * 0 1  1 0  0  i i i  --> separator character with index i
      * 0 1  1 0  1  w w w  --> interned string index expressed in width w
-     * 0 1  0 1  c  c c c  --> encapsulated data (e.g. JWT or UUID)
-     * 0 1  1 1  0  - - -  --> [unused]
+     * 0 1  0 1  c  c c c  --> encapsulated data of kind c (e.g. JWT or UUID)
+     * 0 1  1 1  0  u w w  --> hexadecimal string of length expressed in width w, packed as nibbles, uppercase if u is set
      * 0 1  1 1  1  w w w  --> base64-encoded string of size expressed in width w
      * 1 0  i i  i  i i i  --> embedded interned string with index i
      * 1 1  s s  s  s s s  --> string of embedded size s, followed by characters
      * ```
+     *
+     * Interned strings are kept in a store of type `Store`. With `concurrent_interned_store`, multiple threads may
+     * call `compact` and `expand` on the same compactor simultaneously. With `frozen_interned_store`, compaction never
+     * modifies the store, and strings not in the store are written as literals.
     */
-    template<typename Tokenizer>
+    template<typename Tokenizer, typename Store = interned_store>
     struct Compactor
     {
+        Compactor() = default;
+
+        /** Creates a compactor that uses an existing store of interned strings. */
+        explicit Compactor(Store&& store)
+            : string_store(std::move(store))
+        {
+            static_assert(!Store::read_only || std::is_empty_v<context_type>, "a read-only compactor needs the dictionaries of its tokenizer, use freeze() or load_dictionary");
+        }
+
+        /** Dictionaries the tokenizer keeps besides the store of interned strings. */
+        using context_type = typename Tokenizer::template context_type<Store>;
+
+        /** Creates a compactor that uses an existing store of interned strings and existing tokenizer dictionaries. */
+        Compactor(Store&& store, context_type&& contexts)
+            : string_store(std::move(store)), context_stores(std::move(contexts))
+        {
+        }
+
         /** Transforms a URL into a compact representation. */
         std::basic_string<std::byte> compact(const std::string_view& str);
 
@@ -60,6 +194,37 @@ namespace murify
             return compact(std::string_view(str.data(), str.size()));
         }
 
+        /**
+         * Writes the compact representation of a URL into an output sink.
+         *
+         * With a `byte_string_sink`, the compact representation is appended to an existing string. With a
+         * `byte_span_sink`, the compact representation is written into a fixed-size buffer, and the number of bytes
+         * returned may exceed its capacity, in which case the output is incomplete.
+         *
+         * @return The number of bytes the compact representation takes.
+         */
+        template<typename Output>
+        std::size_t compact_into(const std::string_view& str, Output& out);
+
+        /** An upper bound on the number of bytes the compact representation of a URL takes. */
+        static std::size_t max_compact_size(const std::string_view& str)
+        {
+            // part count takes at most 2 bytes, and each part takes at most 5 bytes more than its characters
+            return 2 + str.size() + 5 * Tokenizer::count(str);
+        }
+
+        /**
+         * Transforms a range of URLs into compact representations stored back to back in a single buffer.
+         *
+         * @param urls A range whose elements convert to `std::string_view`.
+         */
+        template<typename Range>
+        batch compact_batch(const Range& urls);
+
+        /** Appends the compact representations of a range of URLs to an existing batch. */
+        template<typename Range>
+        void compact_batch(const Range& urls, batch& out);
+
         /** Expands a compact representation into a full URL. */
         std::string expand(const std::basic_string_view<std::byte>& enc);
 
@@ -69,159 +234,733 @@ namespace murify
             return expand(std::basic_string_view<std::byte>(enc.data(), enc.size()));
         }
 
+        /** Expands the item with the given index in a batch into a full URL. */
+        std::string expand(const batch& b, std::size_t index)
+        {
+            return expand(b[index]);
+        }
+
+        /**
+         * Writes the full URL a compact representation expands into to an output sink.
+         *
+         * Characters are written directly into the output, separators are inserted as parts are decoded. With a
+         * `string_sink`, the URL is appended to an existing string. With a `span_sink`, the URL is written into a
+         * fixed-size buffer, and the number of characters returned may exceed its capacity, in which case the output
+         * is incomplete.
+         *
+         * @return The number of characters in the full URL.
+         */
+        template<typename Output>
+        std::size_t expand_into(const std::basic_string_view<std::byte>& enc, Output& out);
+
         /** Provides access for de-serialization. */
-        interned_store& store()
+        Store& store()
         {
             return string_store;
         }
 
         /** Provides access for serialization. */
-        const interned_store& store() const
+        const Store& store() const
         {
             return string_store;
         }
 
+        /** Provides access to the dictionaries the tokenizer keeps besides the store of interned strings. */
+        context_type& contexts()
+        {
+            return context_stores;
+        }
+
+        /** Provides access to the dictionaries the tokenizer keeps besides the store of interned strings. */
+        const context_type& contexts() const
+        {
+            return context_stores;
+        }
+
+        /**
+         * Creates a compactor with an immutable snapshot of the interned strings of this compactor.
+         *
+         * The new compactor produces the same output as this compactor for strings already interned, and may be shared
+         * across threads without synchronization.
+         */
+        Compactor<Tokenizer, frozen_interned_store> freeze() const
+        {
+            using frozen_context_type = typename Tokenizer::template context_type<frozen_interned_store>;
+            return Compactor<Tokenizer, frozen_interned_store>(frozen_interned_store(string_store), frozen_context_type(context_stores));
+        }
+
     protected:
         constexpr static char separators[] = { ':', '/', '@', '?', '=', '&', '#', ';' };
 
-        bool compact_separator(std::basic_string<std::byte>& out, char sep);
-        void compact_interned(std::basic_string<std::byte>& out, const std::string_view& part);
-        void compact_string(std::basic_string<std::byte>& out, const std::string_view& part);
-        bool compact_base64(std::basic_string<std::byte>& out, const std::string_view& part);
-        bool compact_jwt(std::basic_string<std::byte>& out, const std::string_view& part);
-        std::size_t expand_single(std::string& out, const std::basic_string_view<std::byte>& enc);
-        std::size_t expand_jwt(std::string& out, const std::basic_string_view<std::byte>& enc);
+        /** Shortest hexadecimal string that is packed as nibbles, which takes fewer bytes than a literal string. */
+        constexpr static std::size_t min_hex_size = 4;
+
+        /** Flag in the width field of a packed hexadecimal string that indicates uppercase letters. */
+        constexpr static unsigned int hex_upper_flag = 0b100;
+
+        /** Flag of an encapsulated IPv6 address, in addition to `detail::ipv6_form`, for an address enclosed in brackets. */
+        constexpr static unsigned int ipv6_bracketed = 1u << 3;
+
+        /** Flag of an encapsulated IPv6 address for a zone ID that follows a `%`. */
+        constexpr static unsigned int ipv6_zone = 1u << 4;
+
+        /** Flag of an encapsulated IPv6 address for a zone ID that follows a percent-encoded `%25`, as in RFC 6874. */
+        constexpr static unsigned int ipv6_zone_escaped = 1u << 5;
+
+        /** Largest JWT header (in bytes, after decoding) that is interned rather than stored as a string. */
+        constexpr static std::size_t max_jwt_header_size = 256;
+
+        /** Longest percent-encoded string that is decoded into a local buffer and written as a token rather than a string. */
+        constexpr static std::size_t max_percent_token_size = 256;
+
+        template<typename Output>
+        void compact_token(Output& out, const std::string_view& part, bool decode_percent = true)
+        {
+            compact_token(out, part, decode_percent, string_store);
+        }
+
+        /** Writes a part, interning strings in the given store rather than in the store of the compactor. */
+        template<typename Output, typename Strings>
+        void compact_token(Output& out, const std::string_view& part, bool decode_percent, Strings& strings);
+        template<typename Output>
+        void compact_integer(Output& out, std::uint64_t number);
+        template<typename Output>
+        void compact_decimal(Output& out, const std::string_view& part);
+        template<typename Output, typename Strings>
+        bool compact_percent(Output& out, const std::string_view& part, Strings& strings);
+        template<typename Output>
+        bool compact_date_time(Output& out, const std::string_view& part);
+        template<typename Output>
+        bool compact_ipv4(Output& out, const std::string_view& part);
+        template<typename Output>
+        bool compact_number(Output& out, const std::string_view& part);
+        template<typename Output, typename Strings>
+        bool compact_ipv6(Output& out, const std::string_view& part, Strings& strings);
+        template<typename Output, typename Strings, typename Write>
+        bool compact_discardable(Output& out, std::size_t limit, Strings& strings, Write&& write);
+        template<typename Output>
+        bool compact_separator(Output& out, char sep);
+        template<typename Output, typename Strings>
+        void compact_interned(Output& out, const std::string_view& part, Strings& strings);
+        template<typename Output>
+        void compact_builtin(Output& out, std::uint32_t index);
+        template<typename Output>
+        void compact_string(Output& out, const std::string_view& part);
+        template<typename Output>
+        void compact_string_length(Output& out, std::uint32_t length);
+        template<typename Output>
+        void compact_decoded(Output& out, const std::string_view& part);
+        template<typename Output>
+        void compact_base64(Output& out, const std::string_view& part);
+        template<typename Output, typename Strings>
+        bool compact_jwt(Output& out, const std::string_view& part, Strings& strings);
+        template<typename Output>
+        void compact_uuid(Output& out, const std::string_view& part, bool upper);
+        template<typename Output>
+        void compact_hex(Output& out, const std::string_view& part, bool upper);
+        template<typename Output>
+        std::size_t expand_single(Output& out, const std::basic_string_view<std::byte>& enc)
+        {
+            return expand_single(out, enc, string_store);
+        }
+
+        /** Reads a part, looking up interned strings in the given store rather than in the store of the compactor. */
+        template<typename Output, typename Strings>
+        std::size_t expand_single(Output& out, const std::basic_string_view<std::byte>& enc, const Strings& strings);
+        template<typename Output>
+        std::size_t expand_decimal(Output& out, const std::basic_string_view<std::byte>& enc);
+        template<typename Output, typename Strings>
+        std::size_t expand_percent(Output& out, const std::basic_string_view<std::byte>& enc, const Strings& strings);
+        static std::size_t read_integer_token(std::uint64_t& value, const std::basic_string_view<std::byte>& enc);
+        template<typename Output, typename Strings>
+        std::size_t expand_jwt(Output& out, const std::basic_string_view<std::byte>& enc, const Strings& strings);
+        template<typename Output>
+        std::size_t expand_uuid(Output& out, const std::basic_string_view<std::byte>& enc, bool upper);
+        template<typename Output>
+        std::size_t expand_hex(Output& out, const std::basic_string_view<std::byte>& enc, unsigned int flags);
+        template<typename Output>
+        std::size_t expand_date_time(Output& out, const std::basic_string_view<std::byte>& enc);
+        template<typename Output>
+        std::size_t expand_ipv4(Output& out, const std::basic_string_view<std::byte>& enc);
+        template<typename Output>
+        std::size_t expand_number(Output& out, const std::basic_string_view<std::byte>& enc);
+        template<typename Output, typename Strings>
+        std::size_t expand_ipv6(Output& out, const std::basic_string_view<std::byte>& enc, const Strings& strings);
+        static std::size_t get_literal_size(std::size_t size);
+        template<typename Strings>
+        std::size_t expand_bytes(std::string_view& out, const std::basic_string_view<std::byte>& enc, const Strings& strings);
 
     private:
-        interned_store string_store;
+        /** Tokenizers with their own layout write and read parts with the encoders of the compactor. */
+        friend Tokenizer;
+
+        Store string_store;
+        context_type context_stores;
     };
 
     struct PathTokenizer : BaseTokenizer
     {
         static std::vector<std::string_view> split(const std::string_view& str);
         static std::string join(const std::vector<std::string>& parts);
+        static std::size_t count(const std::string_view& str);
+        template<typename Fn>
+        static void for_each(const std::string_view& str, Fn&& fn);
+        template<typename Output>
+        static void separate(Output& out, std::size_t index);
     };
 
     struct PathCompactor : Compactor<PathTokenizer>
     {
+        using Compactor::Compactor;
+    };
+
+    struct ConcurrentPathCompactor : Compactor<PathTokenizer, concurrent_interned_store>
+    {
+    };
+
+    struct FrozenPathCompactor : Compactor<PathTokenizer, frozen_interned_store>
+    {
+        using Compactor::Compactor;
     };
 
     struct QueryTokenizer : BaseTokenizer
     {
         static std::vector<std::string_view> split(const std::string_view& str);
         static std::string join(const std::vector<std::string>& parts);
+        static std::size_t count(const std::string_view& str);
+        template<typename Fn>
+        static void for_each(const std::string_view& str, Fn&& fn);
+        template<typename Output>
+        static void separate(Output& out, std::size_t index);
     };
 
     struct QueryCompactor : Compactor<QueryTokenizer>
     {
+        using Compactor::Compactor;
+    };
+
+    struct ConcurrentQueryCompactor : Compactor<QueryTokenizer, concurrent_interned_store>
+    {
+    };
+
+    struct FrozenQueryCompactor : Compactor<QueryTokenizer, frozen_interned_store>
+    {
+        using Compactor::Compactor;
     };
 
     struct URLTokenizer : BaseTokenizer
     {
         static std::vector<std::string_view> split(const std::string_view& str);
         static std::string join(const std::vector<std::string>& parts);
+        static std::size_t count(const std::string_view& str);
+        template<typename Fn>
+        static void for_each(const std::string_view& str, Fn&& fn);
+        template<typename Output>
+        static void separate(Output& out, std::size_t index);
     };
 
     struct URLCompactor : Compactor<URLTokenizer>
     {
+        using Compactor::Compactor;
     };
 
-    template<typename Tokenizer>
-    std::basic_string<std::byte> Compactor<Tokenizer>::compact(const std::string_view& str)
+    struct ConcurrentURLCompactor : Compactor<URLTokenizer, concurrent_interned_store>
     {
-        using detail::Embedding, detail::Coding, detail::DataType, detail::Encapsulation;
-        using detail::control_byte;
+    };
 
+    struct FrozenURLCompactor : Compactor<URLTokenizer, frozen_interned_store>
+    {
+        using Compactor::Compactor;
+    };
+
+    template<typename Tokenizer, typename Store>
+    std::basic_string<std::byte> Compactor<Tokenizer, Store>::compact(const std::string_view& str)
+    {
+        std::basic_string<std::byte> out;
+        byte_string_sink sink(out);
+        compact_into(str, sink);
+        return out;
+    }
+
+    template<typename Tokenizer, typename Store>
+    template<typename Output>
+    std::size_t Compactor<Tokenizer, Store>::compact_into(const std::string_view& str, Output& out)
+    {
         if (str.empty()) {
-            return std::basic_string<std::byte>();
+            return 0;
         }
 
-        auto parts = Tokenizer::split(str);
-
-        std::basic_string<std::byte> out;
-        if (parts.size() < 128) {
-            out.push_back(static_cast<std::byte>(parts.size()));
+        std::size_t start = out.size();
+        if constexpr (Tokenizer::structured) {
+            Tokenizer::compact(*this, str, out);
         } else {
-            // most significant bit denotes a count of 128 or more
-            auto lower = parts.size() & 0xff;
-            auto upper = parts.size() >> 8;
-            out.push_back(static_cast<std::byte>(0x80 | upper));
-            out.push_back(static_cast<std::byte>(lower));
+            std::size_t count = Tokenizer::count(str);
+            if (count < 128) {
+                out.push_back(static_cast<std::byte>(count));
+            } else {
+                // most significant bit denotes a count of 128 or more
+                auto lower = count & 0xff;
+                auto upper = count >> 8;
+                out.push_back(static_cast<std::byte>(0x80 | upper));
+                out.push_back(static_cast<std::byte>(lower));
+            }
+
+            Tokenizer::for_each(str, [this, &out](const std::string_view& part) {
+                compact_token(out, part);
+            });
         }
+        return out.size() - start;
+    }
 
-        for (auto it = parts.begin(); it != parts.end(); ++it) {
-            auto part = *it;
+    template<typename Tokenizer, typename Store>
+    template<typename Range>
+    batch Compactor<Tokenizer, Store>::compact_batch(const Range& urls)
+    {
+        batch out;
+        compact_batch(urls, out);
+        return out;
+    }
+
+    template<typename Tokenizer, typename Store>
+    template<typename Range>
+    void Compactor<Tokenizer, Store>::compact_batch(const Range& urls, batch& out)
+    {
+        for (auto&& url : urls) {
+            out.emplace_back([this, &url](byte_string_sink& sink) {
+                compact_into(std::string_view(url), sink);
+            });
+        }
+    }
+
+    template<typename Tokenizer, typename Store>
+    template<typename Output, typename Strings>
+    void Compactor<Tokenizer, Store>::compact_token(Output& out, const std::string_view& part, bool decode_percent, Strings& strings)
+    {
+        using detail::Embedding, detail::Coding, detail::Encapsulation;
+        using detail::control_byte;
+
+        if (part.empty()) {
+            // empty string with embedded length
+            control_byte control;
+            control.embedded_value.embedding = Embedding::string_length;
+            control.embedded_value.value = 0;
+            out.push_back(control.value);
+            return;
+        }
+
+        if (part.size() == 1) {
+            if (compact_separator(out, part[0])) {
+                return;
+            }
 
-            if (part.empty()) {
-                // empty string with embedded length
+            // single char is always interned
+            compact_interned(out, part, strings);
+            return;
+        }
+
+        // IPv6 address, possibly in brackets or with a percent-encoded zone ID
+        if (part.find(':') != std::string_view::npos && compact_ipv6(out, part, strings)) {
+            return;
+        }
+
+        // percent-encoded string
+        if (decode_percent && part.find('%') != std::string_view::npos && compact_percent(out, part, strings)) {
+            return;
+        }
+
+        // a single scan determines which encodings apply
+        detail::token_class cls = detail::classify(part);
+
+        // string of decimal digits
+        std::uint64_t number;
+        if (cls.has(detail::token_class::digits) && std::from_chars(part.data(), part.data() + part.size(), number).ec == std::errc{}) {
+            // the value zero has a single significant digit
+            std::size_t zeros = std::min(part.find_first_not_of('0'), part.size() - 1);
+            if (zeros > 0) {
+                // integer with leading zeros
                 control_byte control;
-                control.embedded_value.embedding = Embedding::string_length;
-                control.embedded_value.value = 0;
+                control.encapsulated_value.embedding = Embedding::none;
+                control.encapsulated_value.coding = Coding::encapsulated;
+                control.encapsulated_value.identifier = Encapsulation::zero_padded;
                 out.push_back(control.value);
-                continue;
+                compact_integer(out, zeros);
             }
+            compact_integer(out, number);
+            return;
+        }
 
-            if (part.size() == 1) {
-                if (compact_separator(out, part[0])) {
-                    continue;
-                }
+        // string of decimal digits too long for an integer
+        if (cls.has(detail::token_class::digits)) {
+            compact_decimal(out, part);
+            return;
+        }
 
-                // single char is always interned
-                compact_interned(out, part);
-                continue;
-            }
+        // intern-able string
+        if (part.size() < 24 && cls.has(detail::token_class::internable)) {
+            compact_interned(out, part, strings);
+            return;
+        }
 
-            // string of decimal digits
-            std::uint64_t number;
-            std::from_chars_result result = std::from_chars(part.data(), part.data() + part.size(), number);
-            if (result.ec == std::errc{} && result.ptr == part.data() + part.size()) {
-                if (number < 64) {
-                    // embedded integer
-                    control_byte control;
-                    control.embedded_value.embedding = Embedding::integer;
-                    control.embedded_value.value = number;
-                    out.push_back(control.value);
-                } else {
-                    // integer with explicitly specified width and value
-                    unsigned int width = detail::get_integer_width(number);
+        // token in the built-in dictionary that is not intern-able, e.g. `v1` or `index.html`
+        std::uint32_t builtin;
+        if (detail::find_builtin_token(part, builtin)) {
+            compact_builtin(out, builtin);
+            return;
+        }
 
-                    control_byte control;
-                    control.prefixed_value.embedding = Embedding::none;
-                    control.prefixed_value.coding = Coding::width;
-                    control.prefixed_value.data_type = DataType::integer;
-                    control.prefixed_value.width = width - 1;
-                    out.push_back(control.value);
+        // IPv4 address
+        if (cls.dots == 3 && part.size() <= detail::max_ipv4_size && compact_ipv4(out, part)) {
+            return;
+        }
+
+        // ISO 8601 date, or date and time
+        if (part.size() >= 10 && part.size() <= detail::max_date_time_size && compact_date_time(out, part)) {
+            return;
+        }
+
+        // UUID, of a single letter case
+        if (cls.has(detail::token_class::uuid_lower) || cls.has(detail::token_class::uuid_upper)) {
+            compact_uuid(out, part, !cls.has(detail::token_class::uuid_lower));
+            return;
+        }
+
+        // hexadecimal string, of a single letter case
+        if (part.size() >= min_hex_size && (cls.has(detail::token_class::hex_lower) || cls.has(detail::token_class::hex_upper))) {
+            compact_hex(out, part, !cls.has(detail::token_class::hex_lower));
+            return;
+        }
+
+        // signed decimal number, with fractional part or exponent
+        if (part.size() <= detail::max_number_size && compact_number(out, part)) {
+            return;
+        }
+
+        // JWT
+        if (cls.dots == 2 && cls.has(detail::token_class::base64_or_dot) && part[0] == 'e' && part[1] == 'y' && compact_jwt(out, part, strings)) {
+            return;
+        }
+
+        // base64
+        if (part.size() >= 16 && part.size() % 4 == 0 && cls.has(detail::token_class::base64)) {
+            compact_base64(out, part);
+            return;
+        }
+
+        // non-intern-able string
+        compact_string(out, part);
+    }
+
+    template<typename Tokenizer, typename Store>
+    template<typename Output>
+    void Compactor<Tokenizer, Store>::compact_integer(Output& out, std::uint64_t number)
+    {
+        using detail::Embedding, detail::Coding, detail::DataType;
+        using detail::control_byte;
+
+        if (number < 64) {
+            // embedded integer
+            control_byte control;
+            control.embedded_value.embedding = Embedding::integer;
+            control.embedded_value.value = number;
+            out.push_back(control.value);
+        } else {
+            // integer with explicitly specified width and value
+            unsigned int width = detail::get_integer_width(number);
+
+            control_byte control;
+            control.prefixed_value.embedding = Embedding::none;
+            control.prefixed_value.coding = Coding::width;
+            control.prefixed_value.data_type = DataType::integer;
+            control.prefixed_value.width = width - 1;
+            out.push_back(control.value);
+
+            detail::write_integer(out, width, number);
+        }
+    }
 
-                    detail::write_integer(out, width, number);
+    /**
+     * Writes a string of decimal digits as its length followed by limbs of up to 19 digits in binary.
+     *
+     * The most significant limb holds the digits that remain after splitting the string into full limbs from the end,
+     * and takes the number of bytes that any value of as many digits fits. Full limbs take 8 bytes each. Since the
+     * number of digits is recorded, leading zeros are preserved.
+     */
+    template<typename Tokenizer, typename Store>
+    template<typename Output>
+    void Compactor<Tokenizer, Store>::compact_decimal(Output& out, const std::string_view& part)
+    {
+        using detail::Embedding, detail::Coding, detail::Encapsulation;
+        using detail::control_byte;
+        using detail::decimal_limb_digits;
+
+        control_byte control;
+        control.encapsulated_value.embedding = Embedding::none;
+        control.encapsulated_value.coding = Coding::encapsulated;
+        control.encapsulated_value.identifier = Encapsulation::decimal;
+        out.push_back(control.value);
+        compact_integer(out, part.size());
+
+        std::size_t first = (part.size() - 1) % decimal_limb_digits + 1;
+        detail::write_integer(out, detail::get_decimal_width(first), detail::parse_decimal(part.data(), first));
+        for (std::size_t i = first; i < part.size(); i += decimal_limb_digits) {
+            detail::write_integer(out, 8, detail::parse_decimal(part.data() + i, decimal_limb_digits));
+        }
+    }
+
+    /**
+     * Writes a string with percent-escapes as the positions where escaping deviates from canonical form, followed by
+     * the decoded string as a token.
+     *
+     * The number of deviations and the letter case of hexadecimal digits are combined into a single integer. Positions
+     * are written as the distance from the position after the previous deviation. The encoding is discarded if it
+     * takes more space than the string as is, and the decoded string is interned only if the encoding is kept.
+     *
+     * Strings up to `max_percent_token_size` characters are decoded into a local buffer, longer strings straight into
+     * the output as a string, such that no memory is allocated.
+     */
+    template<typename Tokenizer, typename Store>
+    template<typename Output, typename Strings>
+    bool Compactor<Tokenizer, Store>::compact_percent(Output& out, const std::string_view& part, Strings& strings)
+    {
+        using detail::Embedding, detail::Coding, detail::Encapsulation;
+        using detail::control_byte;
+
+        std::array<char, max_percent_token_size> buf;
+        char* decoded = part.size() <= buf.size() ? buf.data() : nullptr;
+        std::size_t size;
+        bool upper;
+        std::size_t deviations = 0;
+        if (!detail::percent_decode(part, decoded, size, upper, [&deviations](std::size_t) { ++deviations; })) {
+            return false;
+        }
+
+        // discard output that takes more space than the string as is
+        return compact_discardable(out, get_literal_size(part.size()), strings, [&](auto& decoded_strings) {
+            control_byte control;
+            control.encapsulated_value.embedding = Embedding::none;
+            control.encapsulated_value.coding = Coding::encapsulated;
+            control.encapsulated_value.identifier = Encapsulation::percent_encoded;
+            out.push_back(control.value);
+
+            compact_integer(out, 2 * deviations + (upper ? 1 : 0));
+
+            // positions are found again with a scan that writes no decoded characters
+            std::size_t next = 0;
+            std::size_t scanned_size;
+            bool scanned_upper;
+            detail::percent_decode(part, nullptr, scanned_size, scanned_upper, [this, &out, &next](std::size_t pos) {
+                compact_integer(out, pos - next);
+                next = pos + 1;
+            });
+
+            if (decoded != nullptr) {
+                compact_token(out, std::string_view(decoded, size), false, decoded_strings);
+            } else {
+                compact_string_length(out, static_cast<std::uint32_t>(size));
+                std::byte* p = out.extend(size);
+                if (p != nullptr) {
+                    detail::percent_decode(part, reinterpret_cast<char*>(p), scanned_size, scanned_upper, [](std::size_t) {});
                 }
-                continue;
             }
+        });
+    }
 
-            // intern-able string
-            if (part.size() < 24 && std::all_of(part.begin(), part.end(), [](char c) { return std::islower(c) || c == '_' || c == '-'; })) {
-                compact_interned(out, part);
-                continue;
+    /**
+     * Writes an encoding unless it takes more than `limit` bytes, such that strings are interned only if it is kept.
+     *
+     * `write` takes the store to intern strings in. The encoding is first measured with a `detail::sizing_store`,
+     * which interns nothing and references all strings with the ordinal zero, and then written with the actual store
+     * if it fits. The decision thus does not depend on ordinals, whereas the encoding written does; it may exceed the
+     * limit by the bytes that interned string indices take beyond the control byte.
+     */
+    template<typename Tokenizer, typename Store>
+    template<typename Output, typename Strings, typename Write>
+    bool Compactor<Tokenizer, Store>::compact_discardable(Output& out, std::size_t limit, Strings& strings, Write&& write)
+    {
+        std::size_t mark = out.size();
+        if constexpr (detail::is_sizing_store<Strings>::value) {
+            // an encoding nested into one that is being measured
+            write(strings);
+            if (out.size() - mark > limit) {
+                out.truncate(mark);
+                return false;
             }
+        } else {
+            detail::sizing_store<Strings> sizing(strings);
+            write(sizing);
+            bool fits = out.size() - mark <= limit;
+            out.truncate(mark);
+            if (!fits) {
+                return false;
+            }
+            write(strings);
+        }
+        return true;
+    }
+
+    template<typename Tokenizer, typename Store>
+    std::size_t Compactor<Tokenizer, Store>::get_literal_size(std::size_t size)
+    {
+        // control byte with embedded length, or control byte followed by length
+        return (size < 64 ? 1 : 1 + detail::get_integer_width(static_cast<std::uint32_t>(size))) + size;
+    }
+
+    /**
+     * Writes an ISO 8601 date, or date and time, as a byte of textual form flags followed by packed fields.
+     *
+     * A date takes 3 bytes as days since 0000-01-01. A date and time takes 5 bytes, with the days in the upper and the
+     * seconds since midnight in the lower 17 bits. A fractional part of seconds is written as the number of digits in a
+     * byte followed by the digits as an integer. A time zone offset is written in minutes in 2 bytes, or in hours in a
+     * single byte.
+     */
+    template<typename Tokenizer, typename Store>
+    template<typename Output>
+    bool Compactor<Tokenizer, Store>::compact_date_time(Output& out, const std::string_view& part)
+    {
+        using detail::Embedding, detail::Coding, detail::Encapsulation;
+        using detail::control_byte;
+        namespace form = detail::date_time_form;
+
+        detail::date_time dt;
+        if (!detail::parse_date_time(part, dt)) {
+            return false;
+        }
+
+        control_byte control;
+        control.encapsulated_value.embedding = Embedding::none;
+        control.encapsulated_value.coding = Coding::encapsulated;
+        control.encapsulated_value.identifier = Encapsulation::date_time;
+        out.push_back(control.value);
+        out.push_back(static_cast<std::byte>(dt.form));
+
+        if ((dt.form & form::time) != 0) {
+            detail::write_integer(out, 5, static_cast<std::uint64_t>(dt.days) << 17 | dt.seconds);
+        } else {
+            detail::write_integer(out, 3, dt.days);
+        }
+        if ((dt.form & form::fraction) != 0) {
+            out.push_back(static_cast<std::byte>(dt.fraction_digits));
+            detail::write_integer(out, detail::get_decimal_width(dt.fraction_digits), dt.fraction);
+        }
+        switch (dt.form & form::zone_mask) {
+        case form::zone_offset:
+            detail::write_integer(out, 2, dt.offset);
+            break;
+        case form::zone_hours:
+            detail::write_integer(out, 1, dt.offset / 60);
+            break;
+        default:
+            break;
+        }
+        return true;
+    }
+
+    template<typename Tokenizer, typename Store>
+    template<typename Output>
+    bool Compactor<Tokenizer, Store>::compact_ipv4(Output& out, const std::string_view& part)
+    {
+        using detail::Embedding, detail::Coding, detail::Encapsulation;
+        using detail::control_byte;
+
+        std::byte address[4];
+        if (!detail::parse_ipv4(part, address)) {
+            return false;
+        }
+
+        control_byte control;
+        control.encapsulated_value.embedding = Embedding::none;
+        control.encapsulated_value.coding = Coding::encapsulated;
+        control.encapsulated_value.identifier = Encapsulation::ipv4;
+        out.push_back(control.value);
+        out.append(address, sizeof(address));
+        return true;
+    }
+
+    /**
+     * Writes a signed decimal number as its textual form and scale combined into an integer, followed by the mantissa
+     * and, in scientific notation, the exponent as integers.
+     */
+    template<typename Tokenizer, typename Store>
+    template<typename Output>
+    bool Compactor<Tokenizer, Store>::compact_number(Output& out, const std::string_view& part)
+    {
+        using detail::Embedding, detail::Coding, detail::Encapsulation;
+        using detail::control_byte;
+
+        detail::decimal_number n;
+        if (!detail::parse_number(part, n)) {
+            return false;
+        }
+
+        std::size_t mark = out.size();
+        control_byte control;
+        control.encapsulated_value.embedding = Embedding::none;
+        control.encapsulated_value.coding = Coding::encapsulated;
+        control.encapsulated_value.identifier = Encapsulation::number;
+        out.push_back(control.value);
+        compact_integer(out, n.form * (detail::max_number_digits + 1) + n.scale);
+        compact_integer(out, n.mantissa);
+        if (n.form / 3 % 3 != 0) {
+            compact_integer(out, n.exponent);
+        }
+
+        // discard output that takes more space than the string as is, e.g. for `1e+1`
+        if (out.size() - mark > get_literal_size(part.size())) {
+            out.truncate(mark);
+            return false;
+        }
+        return true;
+    }
 
-            // JWT
-            if (part.size() >= 2 && part[0] == 'e' && part[1] == 'y' && compact_jwt(out, part)) {
-                continue;
-            }
+    template<typename Tokenizer, typename Store>
+    template<typename Output, typename Strings>
+    bool Compactor<Tokenizer, Store>::compact_ipv6(Output& out, const std::string_view& part, Strings& strings)
+    {
+        using detail::Embedding, detail::Coding, detail::Encapsulation;
+        using detail::control_byte;
 
-            // base64
-            if (part.size() >= 16 && part.size() % 4 == 0 && compact_base64(out, part)) {
-                continue;
+        std::string_view text = part;
+        unsigned int flags = 0;
+        if (text.size() >= 2 && text.front() == '[' && text.back() == ']') {
+            flags |= ipv6_bracketed;
+            text = text.substr(1, text.size() - 2);
+        }
+        std::string_view zone;
+        std::size_t percent = text.find('%');
+        if (percent != std::string_view::npos) {
+            flags |= ipv6_zone;
+            zone = text.substr(percent + 1);
+            text = text.substr(0, percent);
+            if (zone.size() > 2 && zone[0] == '2' && zone[1] == '5') {
+                flags |= ipv6_zone_escaped;
+                zone.remove_prefix(2);
             }
+        }
 
-            // non-intern-able string
-            compact_string(out, part);
+        std::byte address[16];
+        unsigned int form;
+        if (!detail::parse_ipv6(text, address, form)) {
+            return false;
         }
 
-        return out;
+        // discard output that takes more space than the string as is, e.g. for `::1`
+        return compact_discardable(out, get_literal_size(part.size()), strings, [&](auto& zone_strings) {
+            control_byte control;
+            control.encapsulated_value.embedding = Embedding::none;
+            control.encapsulated_value.coding = Coding::encapsulated;
+            control.encapsulated_value.identifier = Encapsulation::ipv6;
+            out.push_back(control.value);
+            out.push_back(static_cast<std::byte>(flags | form));
+            out.append(address, sizeof(address));
+            if ((flags & ipv6_zone) != 0) {
+                compact_token(out, zone, true, zone_strings);
+            }
+        });
     }
 
-    template<typename Tokenizer>
-    bool Compactor<Tokenizer>::compact_separator(std::basic_string<std::byte>& out, char sep)
+    template<typename Tokenizer, typename Store>
+    template<typename Output>
+    bool Compactor<Tokenizer, Store>::compact_separator(Output& out, char sep)
     {
         using detail::Embedding, detail::Coding, detail::DataType;
         using detail::control_byte;
@@ -242,13 +981,24 @@ namespace murify
         return false;
     }
 
-    template<typename Tokenizer>
-    void Compactor<Tokenizer>::compact_string(std::basic_string<std::byte>& out, const std::string_view& part)
+    template<typename Tokenizer, typename Store>
+    template<typename Output>
+    void Compactor<Tokenizer, Store>::compact_string(Output& out, const std::string_view& part)
     {
-        using detail::Embedding, detail::Coding, detail::DataType, detail::Encapsulation;
+        compact_string_length(out, static_cast<std::uint32_t>(part.size()));
+
+        // characters of string
+        auto bytes = detail::string_to_byte(part);
+        out.append(bytes.data(), bytes.size());
+    }
+
+    template<typename Tokenizer, typename Store>
+    template<typename Output>
+    void Compactor<Tokenizer, Store>::compact_string_length(Output& out, std::uint32_t length)
+    {
+        using detail::Embedding, detail::Coding, detail::DataType;
         using detail::control_byte;
 
-        std::uint32_t length = static_cast<unsigned int>(part.size());
         if (length < 64) {
             // short string with embedded length
             control_byte control;
@@ -268,18 +1018,48 @@ namespace murify
 
             detail::write_integer(out, width, length);
         }
+    }
 
-        // characters of string
-        out.append(detail::string_to_byte(part));
+    /**
+     * Writes the bytes a base64url-encoded string decodes into as a string.
+     *
+     * The input must have been validated; bytes are decoded directly into the output.
+     */
+    template<typename Tokenizer, typename Store>
+    template<typename Output>
+    void Compactor<Tokenizer, Store>::compact_decoded(Output& out, const std::string_view& part)
+    {
+        std::size_t length = base64::decoded_size(part.size());
+        compact_string_length(out, static_cast<std::uint32_t>(length));
+        std::byte* p = out.extend(length);
+        if (p != nullptr) {
+            base64::decode(part, p);
+        }
     }
 
-    template<typename Tokenizer>
-    void Compactor<Tokenizer>::compact_interned(std::basic_string<std::byte>& out, const std::string_view& part)
+    template<typename Tokenizer, typename Store>
+    template<typename Output, typename Strings>
+    void Compactor<Tokenizer, Store>::compact_interned(Output& out, const std::string_view& part, Strings& strings)
     {
         using detail::Embedding, detail::Coding, detail::DataType;
         using detail::control_byte;
 
-        interned_string s = string_store.intern(part);
+        interned_string s;
+        if constexpr (std::remove_const_t<Strings>::read_only) {
+            if (!strings.find(part, s)) {
+                // a store that cannot learn falls back to the built-in dictionary
+                std::uint32_t builtin;
+                if (detail::find_builtin_token(part, builtin)) {
+                    compact_builtin(out, builtin);
+                } else {
+                    compact_string(out, part);
+                }
+                return;
+            }
+        } else {
+            s = strings.intern(part);
+        }
+
         std::uint32_t index = s.index();
         if (index < 64) {
             // interned string with embedded index
@@ -302,17 +1082,34 @@ namespace murify
         }
     }
 
-    template<typename Tokenizer>
-    bool Compactor<Tokenizer>::compact_base64(std::basic_string<std::byte>& out, const std::string_view& part)
+    template<typename Tokenizer, typename Store>
+    template<typename Output>
+    void Compactor<Tokenizer, Store>::compact_builtin(Output& out, std::uint32_t index)
+    {
+        using detail::Embedding, detail::Coding, detail::Encapsulation;
+        using detail::control_byte;
+
+        control_byte control;
+        control.encapsulated_value.embedding = Embedding::none;
+        control.encapsulated_value.coding = Coding::encapsulated;
+        control.encapsulated_value.identifier = Encapsulation::builtin;
+        out.push_back(control.value);
+        out.push_back(static_cast<std::byte>(index));
+    }
+
+    /**
+     * Writes a base64url-encoded string as the bytes it decodes into.
+     *
+     * The input must consist of base64url characters, and its length must not leave a remainder of 1 when divided by 4.
+     */
+    template<typename Tokenizer, typename Store>
+    template<typename Output>
+    void Compactor<Tokenizer, Store>::compact_base64(Output& out, const std::string_view& part)
     {
         using detail::Embedding, detail::Coding, detail::DataType;
         using detail::control_byte;
 
-        std::basic_string<std::byte> raw;
-        if (!base64::decode(part, raw)) {
-            return false;
-        }
-        unsigned int length = static_cast<unsigned int>(raw.size());
+        std::uint32_t length = static_cast<std::uint32_t>(base64::decoded_size(part.size()));
         unsigned int width = detail::get_integer_width(length);
 
         control_byte control;
@@ -323,32 +1120,34 @@ namespace murify
         out.push_back(control.value);
 
         detail::write_integer(out, width, length);
-        out.append(raw);
-        return true;
+
+        // decode in place, unless the output has no room for the decoded bytes
+        std::byte* p = out.extend(length);
+        if (p != nullptr) {
+            base64::decode(part, p);
+        }
     }
 
-    template<typename Tokenizer>
-    bool Compactor<Tokenizer>::compact_jwt(std::basic_string<std::byte>& out, const std::string_view& part)
+    /**
+     * Writes a JWT as its decoded header, payload and signature.
+     *
+     * The input must consist of base64url characters and exactly two `.` characters.
+     */
+    template<typename Tokenizer, typename Store>
+    template<typename Output, typename Strings>
+    bool Compactor<Tokenizer, Store>::compact_jwt(Output& out, const std::string_view& part, Strings& strings)
     {
         using detail::Embedding, detail::Coding, detail::Encapsulation;
         using detail::control_byte;
-        using detail::byte_to_string;
 
-        auto jwt_parts = detail::split(part, '.');
-        if (jwt_parts.size() != 3) {
-            return false;
-        }
+        std::size_t first = part.find('.');
+        std::size_t second = part.find('.', first + 1);
+        std::string_view header = part.substr(0, first);
+        std::string_view payload = part.substr(first + 1, second - first - 1);
+        std::string_view signature = part.substr(second + 1);
 
-        std::basic_string<std::byte> header;
-        if (!base64::decode(jwt_parts[0], header)) {
-            return false;
-        }
-        std::basic_string<std::byte> payload;
-        if (!base64::decode(jwt_parts[1], payload)) {
-            return false;
-        }
-        std::basic_string<std::byte> signature;
-        if (!base64::decode(jwt_parts[2], signature)) {
+        // a single character cannot be decoded
+        if (header.size() % 4 == 1 || payload.size() % 4 == 1 || signature.size() % 4 == 1) {
             return false;
         }
 
@@ -358,47 +1157,129 @@ namespace murify
         control.encapsulated_value.identifier = Encapsulation::jwt;
         out.push_back(control.value);
 
-        compact_interned(out, byte_to_string(header));
-        compact_string(out, byte_to_string(payload));
-        compact_string(out, byte_to_string(signature));
+        // header is decoded into a local buffer since interning needs the decoded bytes
+        std::size_t header_length = base64::decoded_size(header.size());
+        if (header_length <= max_jwt_header_size) {
+            std::array<std::byte, max_jwt_header_size> buf;
+            base64::decode(header, buf.data());
+            compact_interned(out, detail::byte_to_string(std::basic_string_view<std::byte>(buf.data(), header_length)), strings);
+        } else {
+            compact_decoded(out, header);
+        }
+        compact_decoded(out, payload);
+        compact_decoded(out, signature);
         return true;
     }
 
-    template<typename Tokenizer>
-    std::string Compactor<Tokenizer>::expand(const std::basic_string_view<std::byte>& enc)
+    /**
+     * Writes a UUID as the 16 bytes its hexadecimal digits encode.
+     *
+     * The input must have the shape of a UUID, with hexadecimal digits of the given letter case.
+     */
+    template<typename Tokenizer, typename Store>
+    template<typename Output>
+    void Compactor<Tokenizer, Store>::compact_uuid(Output& out, const std::string_view& part, bool upper)
+    {
+        using detail::Embedding, detail::Coding, detail::Encapsulation;
+        using detail::control_byte;
+
+        control_byte control;
+        control.encapsulated_value.embedding = Embedding::none;
+        control.encapsulated_value.coding = Coding::encapsulated;
+        control.encapsulated_value.identifier = upper ? Encapsulation::uuid_upper : Encapsulation::uuid;
+        out.push_back(control.value);
+
+        std::byte* p = out.extend(16);
+        if (p != nullptr) {
+            // groups of 8-4-4-4-12 digits
+            detail::hex_decode(part.data(), 4, p);
+            detail::hex_decode(part.data() + 9, 2, p + 4);
+            detail::hex_decode(part.data() + 14, 2, p + 6);
+            detail::hex_decode(part.data() + 19, 2, p + 8);
+            detail::hex_decode(part.data() + 24, 6, p + 10);
+        }
+    }
+
+    /**
+     * Writes a string of hexadecimal digits of the given letter case as its length followed by nibbles, two per byte.
+     *
+     * If the number of digits is odd, the low nibble of the last byte is zero.
+     */
+    template<typename Tokenizer, typename Store>
+    template<typename Output>
+    void Compactor<Tokenizer, Store>::compact_hex(Output& out, const std::string_view& part, bool upper)
     {
-        if (enc.empty()) {
-            return std::string();
+        using detail::Embedding, detail::Coding, detail::DataType;
+        using detail::control_byte;
+
+        std::uint32_t length = static_cast<std::uint32_t>(part.size());
+        unsigned int width = detail::get_integer_width(length);
+
+        control_byte control;
+        control.prefixed_value.embedding = Embedding::none;
+        control.prefixed_value.coding = Coding::base64;
+        control.prefixed_value.data_type = DataType::integer;
+        control.prefixed_value.width = (upper ? hex_upper_flag : 0) | (width - 1);
+        out.push_back(control.value);
+
+        detail::write_integer(out, width, length);
+
+        std::byte* p = out.extend((length + 1) / 2);
+        if (p != nullptr) {
+            detail::hex_decode(part.data(), length / 2, p);
+            if (length % 2 != 0) {
+                p[length / 2] = static_cast<std::byte>(detail::hex_value(part.back()) << 4);
+            }
         }
+    }
+
+    template<typename Tokenizer, typename Store>
+    std::string Compactor<Tokenizer, Store>::expand(const std::basic_string_view<std::byte>& enc)
+    {
+        std::string out;
+        string_sink sink(out);
+        expand_into(enc, sink);
+        return out;
+    }
 
-        std::vector<std::string> parts;
+    template<typename Tokenizer, typename Store>
+    template<typename Output>
+    std::size_t Compactor<Tokenizer, Store>::expand_into(const std::basic_string_view<std::byte>& enc, Output& out)
+    {
+        if (enc.empty()) {
+            return 0;
+        }
 
-        std::size_t index = 0;
-        std::size_t count = 0;
-        auto value = static_cast<std::size_t>(enc[index]);
-        if (value < 128) {
-            count = value;
+        std::size_t start = out.size();
+        if constexpr (Tokenizer::structured) {
+            Tokenizer::expand(*this, enc, out);
         } else {
+            std::size_t index = 0;
+            std::size_t count = 0;
+            auto value = static_cast<std::size_t>(enc[index]);
+            if (value < 128) {
+                count = value;
+            } else {
+                ++index;
+                count = ((value & 0x7f) << 8) | static_cast<std::size_t>(enc[index]);
+            }
             ++index;
-            count = ((value & 0x7f) << 8) | static_cast<std::size_t>(enc[index]);
-        }
-        ++index;
-        parts.reserve(count);
 
-        for (std::size_t i = 0; i < count; ++i) {
-            std::string part;
-            index += expand_single(part, enc.substr(index));
-            parts.push_back(part);
+            for (std::size_t i = 0; i < count; ++i) {
+                Tokenizer::separate(out, i);
+                index += expand_single(out, enc.substr(index));
+            }
         }
-        return Tokenizer::join(parts);
+        return out.size() - start;
     }
 
-    template<typename Tokenizer>
-    std::size_t Compactor<Tokenizer>::expand_single(std::string& out, const std::basic_string_view<std::byte>& enc)
+    template<typename Tokenizer, typename Store>
+    template<typename Output, typename Strings>
+    std::size_t Compactor<Tokenizer, Store>::expand_single(Output& out, const std::basic_string_view<std::byte>& enc, const Strings& strings)
     {
         using detail::Embedding, detail::Coding, detail::DataType, detail::Encapsulation;
         using detail::control_byte;
-        using detail::byte_to_string, detail::read_integer;
+        using detail::read_integer;
 
         std::size_t index = 0;
         control_byte control;
@@ -408,20 +1289,26 @@ namespace murify
         std::size_t length;
         unsigned int width;
         unsigned long long value;
+        std::array<char, 20> digits;
+        std::string_view str;
 
         switch (control.embedded_value.embedding) {
         case Embedding::integer:
             // embedded integer
-            out = std::to_string(control.embedded_value.value);
+            {
+                auto result = std::to_chars(digits.data(), digits.data() + digits.size(), control.embedded_value.value);
+                out.append(digits.data(), result.ptr - digits.data());
+            }
             break;
         case Embedding::interned_string:
             // interned string with embedded index
-            out = interned_string(control.embedded_value.value).data(string_store);
+            str = strings.str(interned_string(control.embedded_value.value));
+            out.append(str.data(), str.size());
             break;
         case Embedding::string_length:
             // string with embedded length
             length = control.embedded_value.value;
-            out = byte_to_string(enc.substr(index, length));
+            out.append(reinterpret_cast<const char*>(enc.data() + index), length);
             index += length;
             break;
         case Embedding::none:
@@ -433,13 +1320,16 @@ namespace murify
                     // integer with externally specified value
                     value = read_integer(enc.substr(index, width));
                     index += width;
-                    out = std::to_string(value);
+                    {
+                        auto result = std::to_chars(digits.data(), digits.data() + digits.size(), value);
+                        out.append(digits.data(), result.ptr - digits.data());
+                    }
                     break;
                 case DataType::string:
                     // string with externally specified length
                     length = read_integer(enc.substr(index, width));
                     index += width;
-                    out = byte_to_string(enc.substr(index, length));
+                    out.append(reinterpret_cast<const char*>(enc.data() + index), length);
                     index += length;
                     break;
                 }
@@ -448,14 +1338,15 @@ namespace murify
                 switch (control.prefixed_value.data_type) {
                 case DataType::integer:
                     // embedded separator character index
-                    out = separators[control.prefixed_value.width];
+                    out.push_back(separators[control.prefixed_value.width]);
                     break;
                 case DataType::string:
                     // interned string with externally specified index
                     width = control.prefixed_value.width + 1;
                     std::uint32_t string_index = static_cast<std::uint32_t>(read_integer(enc.substr(index, width)));
                     index += width;
-                    out = interned_string(string_index).data(string_store);
+                    str = strings.str(interned_string(string_index));
+                    out.append(str.data(), str.size());
                     break;
                 }
                 break;
@@ -463,12 +1354,19 @@ namespace murify
                 width = control.prefixed_value.width + 1;
                 switch (control.prefixed_value.data_type) {
                 case DataType::integer:
-                    throw std::runtime_error("base64 encoding not implemented for integer type");
+                    // hexadecimal string packed as nibbles
+                    index += expand_hex(out, enc.substr(index), control.prefixed_value.width);
+                    break;
                 case DataType::string:
                     // base64 decoded string with externally specified size
                     length = read_integer(enc.substr(index, width));
                     index += width;
-                    out = base64::encode(enc.substr(index, length));
+                    {
+                        char* p = out.extend(base64::encoded_size(length));
+                        if (p != nullptr) {
+                            base64::encode(enc.substr(index, length), p);
+                        }
+                    }
                     index += length;
                     break;
                 }
@@ -478,7 +1376,52 @@ namespace murify
                 {
                 case Encapsulation::jwt:
                     // encapsulated JWT
-                    index += expand_jwt(out, enc.substr(index));
+                    index += expand_jwt(out, enc.substr(index), strings);
+                    break;
+                case Encapsulation::zero_padded:
+                    // integer with leading zeros
+                    {
+                        std::uint64_t zeros;
+                        std::uint64_t number;
+                        index += read_integer_token(zeros, enc.substr(index));
+                        index += read_integer_token(number, enc.substr(index));
+                        char* p = out.extend(zeros);
+                        if (p != nullptr) {
+                            std::fill_n(p, zeros, '0');
+                        }
+                        auto result = std::to_chars(digits.data(), digits.data() + digits.size(), number);
+                        out.append(digits.data(), result.ptr - digits.data());
+                    }
+                    break;
+                case Encapsulation::decimal:
+                    // string of decimal digits in limbs
+                    index += expand_decimal(out, enc.substr(index));
+                    break;
+                case Encapsulation::percent_encoded:
+                    // string with percent-escapes
+                    index += expand_percent(out, enc.substr(index), strings);
+                    break;
+                case Encapsulation::uuid:
+                case Encapsulation::uuid_upper:
+                    // encapsulated UUID
+                    index += expand_uuid(out, enc.substr(index), control.encapsulated_value.identifier == Encapsulation::uuid_upper);
+                    break;
+                case Encapsulation::ipv4:
+                    index += expand_ipv4(out, enc.substr(index));
+                    break;
+                case Encapsulation::ipv6:
+                    index += expand_ipv6(out, enc.substr(index), strings);
+                    break;
+                case Encapsulation::date_time:
+                    index += expand_date_time(out, enc.substr(index));
+                    break;
+                case Encapsulation::number:
+                    index += expand_number(out, enc.substr(index));
+                    break;
+                case Encapsulation::builtin:
+                    // token in the built-in dictionary
+                    str = detail::builtin_tokens[static_cast<unsigned int>(enc[index++])];
+                    out.append(str.data(), str.size());
                     break;
                 default:
                     throw std::runtime_error("encapsulated encoding not implemented");
@@ -490,32 +1433,359 @@ namespace murify
         return index;
     }
 
-    template<typename Tokenizer>
-    std::size_t Compactor<Tokenizer>::expand_jwt(std::string& out, const std::basic_string_view<std::byte>& enc)
+    template<typename Tokenizer, typename Store>
+    template<typename Output, typename Strings>
+    std::size_t Compactor<Tokenizer, Store>::expand_jwt(Output& out, const std::basic_string_view<std::byte>& enc, const Strings& strings)
     {
         using detail::string_to_byte;
 
-        std::string header;
-        std::size_t index = expand_single(header, enc);
-        std::string payload;
-        index += expand_single(payload, enc.substr(index));
-        std::string signature;
-        index += expand_single(signature, enc.substr(index));
+        std::string_view header;
+        std::size_t index = expand_bytes(header, enc, strings);
+        std::string_view payload;
+        index += expand_bytes(payload, enc.substr(index), strings);
+        std::string_view signature;
+        index += expand_bytes(signature, enc.substr(index), strings);
+
+        std::size_t header_size = base64::encoded_size(header.size());
+        std::size_t payload_size = base64::encoded_size(payload.size());
+        std::size_t signature_size = base64::encoded_size(signature.size());
+        char* p = out.extend(header_size + payload_size + signature_size + 2);
+        if (p != nullptr) {
+            base64::encode(string_to_byte(header), p);
+            p += header_size;
+            *p++ = '.';
+            base64::encode(string_to_byte(payload), p);
+            p += payload_size;
+            *p++ = '.';
+            base64::encode(string_to_byte(signature), p);
+        }
+
+        return index;
+    }
+
+    template<typename Tokenizer, typename Store>
+    template<typename Output>
+    std::size_t Compactor<Tokenizer, Store>::expand_date_time(Output& out, const std::basic_string_view<std::byte>& enc)
+    {
+        namespace form = detail::date_time_form;
+
+        detail::date_time dt;
+        dt.form = static_cast<unsigned int>(enc[0]) & form::all;
+        std::size_t index = 1;
+        if ((dt.form & form::time) != 0) {
+            std::uint64_t packed = detail::read_integer(enc.substr(index, 5));
+            dt.days = static_cast<std::uint32_t>(packed >> 17);
+            dt.seconds = static_cast<std::uint32_t>(packed & 0x1ffff);
+            index += 5;
+        } else {
+            dt.days = static_cast<std::uint32_t>(detail::read_integer(enc.substr(index, 3)));
+            index += 3;
+        }
+        if ((dt.form & form::fraction) != 0) {
+            dt.fraction_digits = static_cast<std::uint32_t>(enc[index++]);
+            unsigned int width = detail::get_decimal_width(dt.fraction_digits);
+            dt.fraction = static_cast<std::uint32_t>(detail::read_integer(enc.substr(index, width)));
+            index += width;
+        }
+        switch (dt.form & form::zone_mask) {
+        case form::zone_offset:
+            dt.offset = static_cast<std::uint32_t>(detail::read_integer(enc.substr(index, 2)));
+            index += 2;
+            break;
+        case form::zone_hours:
+            dt.offset = 60 * static_cast<std::uint32_t>(enc[index++]);
+            break;
+        default:
+            break;
+        }
+
+        char text[detail::max_date_time_size];
+        out.append(text, detail::format_date_time(dt, text));
+        return index;
+    }
+
+    template<typename Tokenizer, typename Store>
+    template<typename Output>
+    std::size_t Compactor<Tokenizer, Store>::expand_number(Output& out, const std::basic_string_view<std::byte>& enc)
+    {
+        std::uint64_t header;
+        std::size_t index = read_integer_token(header, enc);
+        detail::decimal_number n;
+        n.form = static_cast<unsigned int>(header / (detail::max_number_digits + 1) % detail::number_form_count);
+        n.scale = static_cast<std::uint32_t>(header % (detail::max_number_digits + 1));
+        index += read_integer_token(n.mantissa, enc.substr(index));
+        if (n.form / 3 % 3 != 0) {
+            index += read_integer_token(n.exponent, enc.substr(index));
+        }
+
+        char text[detail::max_number_size];
+        out.append(text, detail::format_number(n, text));
+        return index;
+    }
+
+    template<typename Tokenizer, typename Store>
+    template<typename Output>
+    std::size_t Compactor<Tokenizer, Store>::expand_ipv4(Output& out, const std::basic_string_view<std::byte>& enc)
+    {
+        char text[detail::max_ipv4_size];
+        out.append(text, detail::format_ipv4(enc.data(), text));
+        return 4;
+    }
+
+    template<typename Tokenizer, typename Store>
+    template<typename Output, typename Strings>
+    std::size_t Compactor<Tokenizer, Store>::expand_ipv6(Output& out, const std::basic_string_view<std::byte>& enc, const Strings& strings)
+    {
+        unsigned int flags = static_cast<unsigned int>(enc[0]);
+        std::size_t index = 1;
+        if ((flags & ipv6_bracketed) != 0) {
+            out.push_back('[');
+        }
+        char text[detail::max_ipv6_size];
+        out.append(text, detail::format_ipv6(enc.data() + index, flags & detail::ipv6_form::all, text));
+        index += 16;
+        if ((flags & ipv6_zone) != 0) {
+            if ((flags & ipv6_zone_escaped) != 0) {
+                out.append("%25", 3);
+            } else {
+                out.push_back('%');
+            }
+            index += expand_single(out, enc.substr(index), strings);
+        }
+        if ((flags & ipv6_bracketed) != 0) {
+            out.push_back(']');
+        }
+        return index;
+    }
+
+    template<typename Tokenizer, typename Store>
+    template<typename Output>
+    std::size_t Compactor<Tokenizer, Store>::expand_uuid(Output& out, const std::basic_string_view<std::byte>& enc, bool upper)
+    {
+        char* p = out.extend(36);
+        if (p != nullptr) {
+            const std::byte* data = enc.data();
+            detail::hex_encode(data, 4, p, upper);
+            p[8] = '-';
+            detail::hex_encode(data + 4, 2, p + 9, upper);
+            p[13] = '-';
+            detail::hex_encode(data + 6, 2, p + 14, upper);
+            p[18] = '-';
+            detail::hex_encode(data + 8, 2, p + 19, upper);
+            p[23] = '-';
+            detail::hex_encode(data + 10, 6, p + 24, upper);
+        }
+        return 16;
+    }
+
+    template<typename Tokenizer, typename Store>
+    template<typename Output>
+    std::size_t Compactor<Tokenizer, Store>::expand_hex(Output& out, const std::basic_string_view<std::byte>& enc, unsigned int flags)
+    {
+        unsigned int width = (flags & ~hex_upper_flag) + 1;
+        bool upper = (flags & hex_upper_flag) != 0;
+        std::size_t length = detail::read_integer(enc.substr(0, width));
+        char* p = out.extend(length);
+        if (p != nullptr) {
+            const std::byte* data = enc.data() + width;
+            detail::hex_encode(data, length / 2, p, upper);
+            if (length % 2 != 0) {
+                p[length - 1] = detail::hex_digit(static_cast<unsigned int>(data[length / 2]) >> 4, upper);
+            }
+        }
+        return width + (length + 1) / 2;
+    }
+
+    template<typename Tokenizer, typename Store>
+    template<typename Output>
+    std::size_t Compactor<Tokenizer, Store>::expand_decimal(Output& out, const std::basic_string_view<std::byte>& enc)
+    {
+        using detail::decimal_limb_digits;
+
+        std::uint64_t length;
+        std::size_t index = read_integer_token(length, enc);
+        std::size_t first = (length - 1) % decimal_limb_digits + 1;
+        unsigned int first_width = detail::get_decimal_width(first);
+        std::size_t limbs = (length - first) / decimal_limb_digits;
+
+        char* p = out.extend(length);
+        if (p != nullptr) {
+            detail::format_decimal(detail::read_integer(enc.substr(index, first_width)), p, first);
+            for (std::size_t k = 0; k < limbs; ++k) {
+                detail::format_decimal(detail::read_integer(enc.substr(index + first_width + 8 * k, 8)), p + first + k * decimal_limb_digits, decimal_limb_digits);
+            }
+        }
+        return index + first_width + 8 * limbs;
+    }
+
+    template<typename Tokenizer, typename Store>
+    template<typename Output, typename Strings>
+    std::size_t Compactor<Tokenizer, Store>::expand_percent(Output& out, const std::basic_string_view<std::byte>& enc, const Strings& strings)
+    {
+        std::uint64_t header;
+        std::size_t index = read_integer_token(header, enc);
+        bool upper = (header & 1) != 0;
+
+        // positions of deviations are read again as characters are written
+        std::size_t first = index;
+        for (std::uint64_t k = 0; k < (header >> 1); ++k) {
+            std::uint64_t distance;
+            index += read_integer_token(distance, enc.substr(index));
+        }
 
-        out.append(base64::encode(string_to_byte(header)));
-        out += '.';
-        out.append(base64::encode(string_to_byte(payload)));
-        out += '.';
-        out.append(base64::encode(string_to_byte(signature)));
+        // a decoded token is expanded into a local buffer, and a long decoded string is used in place
+        std::array<char, max_percent_token_size> buf;
+        span_sink sink(buf.data(), buf.size());
+        std::size_t start = index;
+        index += expand_single(sink, enc.substr(index), strings);
+        std::string_view decoded(buf.data(), sink.size());
+        if (sink.size() > buf.size()) {
+            expand_bytes(decoded, enc.substr(start), strings);
+        }
 
+        // characters are escaped in canonical form if they are not unreserved, unless they deviate
+        auto for_each_char = [&](auto&& fn) {
+            std::size_t at = first;
+            std::uint64_t remaining = header >> 1;
+            std::size_t deviation = decoded.size();
+            auto advance = [&](std::size_t from) {
+                deviation = decoded.size();
+                if (remaining > 0) {
+                    std::uint64_t distance;
+                    at += read_integer_token(distance, enc.substr(at));
+                    deviation = from + static_cast<std::size_t>(distance);
+                    --remaining;
+                }
+            };
+            advance(0);
+            for (std::size_t pos = 0; pos < decoded.size(); ++pos) {
+                bool deviates = pos == deviation;
+                if (deviates) {
+                    advance(pos + 1);
+                }
+                fn(decoded[pos], !detail::percent_unreserved.contains(decoded[pos]) != deviates);
+            }
+        };
+        std::size_t escapes = 0;
+        for_each_char([&escapes](char, bool escaped) {
+            escapes += escaped ? 1 : 0;
+        });
+
+        char* p = out.extend(decoded.size() + 2 * escapes);
+        if (p != nullptr) {
+            for_each_char([&p, upper](char c, bool escaped) {
+                if (escaped) {
+                    unsigned int value = static_cast<unsigned char>(c);
+                    *p++ = '%';
+                    *p++ = detail::hex_digit(value >> 4, upper);
+                    *p++ = detail::hex_digit(value & 0x0f, upper);
+                } else {
+                    *p++ = c;
+                }
+            });
+        }
         return index;
     }
 
+    /**
+     * Reads the value of an embedded integer or an integer with explicitly specified width.
+     */
+    template<typename Tokenizer, typename Store>
+    std::size_t Compactor<Tokenizer, Store>::read_integer_token(std::uint64_t& value, const std::basic_string_view<std::byte>& enc)
+    {
+        using detail::Embedding, detail::Coding, detail::DataType;
+        using detail::control_byte;
+
+        control_byte control;
+        control.value = enc[0];
+        if (control.embedded_value.embedding == Embedding::integer) {
+            value = control.embedded_value.value;
+            return 1;
+        }
+        if (control.prefixed_value.embedding == Embedding::none && control.prefixed_value.coding == Coding::width && control.prefixed_value.data_type == DataType::integer) {
+            unsigned int width = control.prefixed_value.width + 1;
+            value = detail::read_integer(enc.substr(1, width));
+            return 1 + width;
+        }
+        throw std::runtime_error("expected integer");
+    }
+
+    /**
+     * Resolves an interned or literal string to a view of its bytes, without copying.
+     */
+    template<typename Tokenizer, typename Store>
+    template<typename Strings>
+    std::size_t Compactor<Tokenizer, Store>::expand_bytes(std::string_view& out, const std::basic_string_view<std::byte>& enc, const Strings& strings)
+    {
+        using detail::Embedding, detail::Coding, detail::DataType;
+        using detail::control_byte;
+        using detail::byte_to_string, detail::read_integer;
+
+        std::size_t index = 0;
+        control_byte control;
+        control.value = enc[index];
+        ++index;
+
+        std::size_t length;
+        unsigned int width;
+
+        switch (control.embedded_value.embedding) {
+        case Embedding::interned_string:
+            // interned string with embedded index
+            out = strings.str(interned_string(control.embedded_value.value));
+            return index;
+        case Embedding::string_length:
+            // string with embedded length
+            length = control.embedded_value.value;
+            out = byte_to_string(enc.substr(index, length));
+            return index + length;
+        case Embedding::none:
+            width = control.prefixed_value.width + 1;
+            if (control.prefixed_value.data_type == DataType::string) {
+                if (control.prefixed_value.coding == Coding::width) {
+                    // string with externally specified length
+                    length = read_integer(enc.substr(index, width));
+                    index += width;
+                    out = byte_to_string(enc.substr(index, length));
+                    return index + length;
+                } else if (control.prefixed_value.coding == Coding::indexed) {
+                    // interned string with externally specified index
+                    std::uint32_t string_index = static_cast<std::uint32_t>(read_integer(enc.substr(index, width)));
+                    out = strings.str(interned_string(string_index));
+                    return index + width;
+                }
+            }
+            break;
+        default:
+            break;
+        }
+        throw std::runtime_error("expected an interned or literal string");
+    }
+
     inline std::vector<std::string_view> PathTokenizer::split(const std::string_view& str)
     {
         return detail::split(str, '/');
     }
 
+    inline std::size_t PathTokenizer::count(const std::string_view& str)
+    {
+        return detail::count_parts(str, '/');
+    }
+
+    template<typename Fn>
+    void PathTokenizer::for_each(const std::string_view& str, Fn&& fn)
+    {
+        detail::for_each_part(str, '/', fn);
+    }
+
+    template<typename Output>
+    void PathTokenizer::separate(Output& out, std::size_t index)
+    {
+        if (index > 0) {
+            out.push_back('/');
+        }
+    }
+
     inline std::string PathTokenizer::join(const std::vector<std::string>& parts)
     {
         return detail::join(parts, '/');
@@ -540,6 +1810,52 @@ namespace murify
         return parts;
     }
 
+    inline std::size_t QueryTokenizer::count(const std::string_view& str)
+    {
+        return 3 * detail::count_parts(str, '&');
+    }
+
+    template<typename Fn>
+    void QueryTokenizer::for_each(const std::string_view& str, Fn&& fn)
+    {
+        // emits key, separator and value of the pair that ends at the given position
+        std::size_t start = 0;
+        std::size_t equals = std::string_view::npos;
+        auto pair = [&](std::size_t end) {
+            if (equals != std::string_view::npos) {
+                fn(str.substr(start, equals - start));
+                fn(std::string_view("=", 1));
+                fn(str.substr(equals + 1, end - equals - 1));
+            } else {
+                fn(str.substr(start, end - start));
+                fn(std::string_view());
+                fn(std::string_view());
+            }
+        };
+
+        // a single scan finds both pair separators and the first key-value separator in each pair
+        constexpr detail::char_set separators("&=");
+        separators.for_each_in(str, [&](std::size_t p) {
+            if (str[p] == '&') {
+                pair(p);
+                start = p + 1;
+                equals = std::string_view::npos;
+            } else if (equals == std::string_view::npos) {
+                equals = p;
+            }
+        });
+        pair(str.size());
+    }
+
+    template<typename Output>
+    void QueryTokenizer::separate(Output& out, std::size_t index)
+    {
+        // parts are key, separator and value triplets
+        if (index > 0 && index % 3 == 0) {
+            out.push_back('&');
+        }
+    }
+
     inline std::string QueryTokenizer::join(const std::vector<std::string>& parts)
     {
         std::vector<std::string> pieces;
@@ -565,6 +1881,25 @@ namespace murify
         return detail::tokenize(str, ":/?&=#");
     }
 
+    inline std::size_t URLTokenizer::count(const std::string_view& str)
+    {
+        constexpr detail::char_set separators(":/?&=#");
+        return detail::count_tokens(str, separators);
+    }
+
+    template<typename Fn>
+    void URLTokenizer::for_each(const std::string_view& str, Fn&& fn)
+    {
+        constexpr detail::char_set separators(":/?&=#");
+        detail::for_each_token(str, separators, fn);
+    }
+
+    template<typename Output>
+    void URLTokenizer::separate(Output&, std::size_t)
+    {
+        // separators are parts of their own
+    }
+
     inline std::string URLTokenizer::join(const std::vector<std::string>& parts)
     {
         return detail::join(parts);
@@ -0,0 +1,359 @@
+/**
+ * murify: Efficient in-memory compression for URLs
+ * @see https://github.com/hunyadi/murify
+ *
+ * Copyright (c) 2024 Levente Hunyadi
+ *
+ * This work is licensed under the terms of the MIT license.
+ * For a copy, see <https://opensource.org/licenses/MIT>.
+ */
+
+#pragma once
+#include "interned_string.hpp"
+#include "detail/hash_index.hpp"
+
+#include <string_view>
+#include <string>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <mutex>
+#include <algorithm>
+#include <stdexcept>
+#include <cstdint>
+#include <cstring>
+
+namespace murify
+{
+    /**
+     * Maps strings into ordinals of an indexed array of strings, and admits concurrent use from multiple threads.
+     *
+     * Looking up a string that is already in the store takes no locks. New strings are inserted into one of several
+     * shards, each guarded by a mutex of its own, and take the next ordinal from a shared counter, such that ordinals
+     * remain dense. Strings are neither moved nor removed while the store is in use, which lets readers access
+     * characters without synchronization.
+     *
+     * Each shard has an open-addressing hash table whose slots are atomic 64-bit words. Inserting a string publishes
+     * its slot with release semantics after the characters are written. When a shard table grows, the old table is
+     * retained until the store is cleared, such that readers that still probe the old table remain safe; a reader
+     * that misses a string inserted in the meantime re-checks under the lock of the shard.
+     *
+     * `count()`, iteration and `clear()` are only meaningful when no other thread is interning strings.
+     */
+    struct concurrent_interned_store
+    {
+        /** Strings can be added to the store. */
+        constexpr static bool read_only = false;
+
+        concurrent_interned_store() = default;
+
+        concurrent_interned_store(const concurrent_interned_store&) = delete;
+
+        ~concurrent_interned_store()
+        {
+            clear();
+        }
+
+        /** The characters of a string stored in the indexed array. */
+        const char* data(const interned_string& s) const
+        {
+            return entry_at(s.index()).data;
+        }
+
+        /** String length. */
+        std::size_t size(const interned_string& s) const
+        {
+            return entry_at(s.index()).size;
+        }
+
+        /** A string view over the characters stored in the indexed array. */
+        std::string_view str(const interned_string& s) const
+        {
+            const entry& e = entry_at(s.index());
+            return std::string_view(e.data, e.size);
+        }
+
+        using const_iterator = interned_store_iterator<concurrent_interned_store>;
+
+        /** Number of strings stored in the indexed array. */
+        std::size_t count() const
+        {
+            return _count.load(std::memory_order_acquire);
+        }
+
+        const_iterator begin() const
+        {
+            return const_iterator(*this, 0);
+        }
+
+        const_iterator end() const
+        {
+            return const_iterator(*this, static_cast<std::uint32_t>(count()));
+        }
+
+        /** Deallocates and removes all strings in the indexed array. Must not be called concurrently with other methods. */
+        void clear()
+        {
+            for (std::size_t k = 0; k < shard_count; ++k) {
+                shard& sh = _shards[k];
+                sh.current.store(nullptr, std::memory_order_relaxed);
+                sh.tables.clear();
+                sh.size = 0;
+                sh.chunks.clear();
+                sh.chunk_used = 0;
+                sh.chunk_capacity = 0;
+            }
+            for (auto&& segment : _segments) {
+                delete[] segment.exchange(nullptr, std::memory_order_relaxed);
+            }
+            _count.store(0, std::memory_order_relaxed);
+        }
+
+        interned_string intern(const char* beg, const char* end)
+        {
+            return intern(std::string_view(beg, end - beg));
+        }
+
+        interned_string intern(const char* beg, std::size_t siz)
+        {
+            return intern(std::string_view(beg, siz));
+        }
+
+        interned_string intern(const std::string& str)
+        {
+            return intern(std::string_view(str.data(), str.size()));
+        }
+
+        /** Looks up the ordinal of a string without adding it to the indexed array. Thread-safe. */
+        bool find(const std::string_view& str, interned_string& s) const
+        {
+            std::uint64_t hash = detail::hash_bytes(str.data(), str.size());
+            const shard& sh = _shards[(hash >> 7) & (shard_count - 1)];
+            std::uint32_t index;
+            if (!find(sh.current.load(std::memory_order_acquire), hash, str, index)) {
+                return false;
+            }
+            s = interned_string(index);
+            return true;
+        }
+
+        /** Adds a new string to the indexed array and assigns an ordinal to the interned string. Thread-safe. */
+        interned_string intern(const std::string_view& str)
+        {
+            std::uint64_t hash = detail::hash_bytes(str.data(), str.size());
+            shard& sh = _shards[(hash >> 7) & (shard_count - 1)];
+
+            // lock-free path for strings already in the store
+            std::uint32_t index;
+            if (find(sh.current.load(std::memory_order_acquire), hash, str, index)) {
+                return interned_string(index);
+            }
+
+            std::lock_guard<std::mutex> lock(sh.mutex);
+
+            // string may have been inserted since the lock-free lookup
+            if (find(sh.current.load(std::memory_order_relaxed), hash, str, index)) {
+                return interned_string(index);
+            }
+
+            // characters are followed by a terminating null character
+            char* s = sh.allocate(str.size() + 1);
+            std::memcpy(s, str.data(), str.size());
+            s[str.size()] = 0;
+
+            std::uint32_t count = _count.load(std::memory_order_relaxed);
+            do {
+                if (count == max_count) {
+                    throw std::length_error("interned string ordinals exhausted");
+                }
+            } while (!_count.compare_exchange_weak(count, count + 1, std::memory_order_acq_rel, std::memory_order_relaxed));
+            index = count;
+
+            entry& e = entry_for_write(index);
+            e.data = s;
+            e.size = static_cast<std::uint32_t>(str.size());
+
+            sh.insert(hash, index);
+            return interned_string(index);
+        }
+
+    private:
+        struct entry
+        {
+            const char* data;
+            std::uint32_t size;
+        };
+
+        /**
+         * Hash table of a shard with slots that pack the upper 32 bits of the hash and the ordinal plus one.
+         * A slot value of zero marks an empty slot.
+         */
+        struct table
+        {
+            explicit table(std::size_t capacity)
+                : slots(new std::atomic<std::uint64_t>[capacity]), mask(capacity - 1)
+            {
+                for (std::size_t k = 0; k < capacity; ++k) {
+                    slots[k].store(0, std::memory_order_relaxed);
+                }
+            }
+
+            std::unique_ptr<std::atomic<std::uint64_t>[]> slots;
+            std::size_t mask;
+        };
+
+#if defined(_MSC_VER)
+#pragma warning(push)
+// structure was padded due to alignment specifier, which is intended to keep shards on separate cache lines
+#pragma warning(disable: 4324)
+#endif
+        struct alignas(64) shard
+        {
+            std::mutex mutex;
+
+            /** The table readers probe without taking the lock. */
+            std::atomic<table*> current{ nullptr };
+
+            /** All tables allocated for the shard, of which the last one is current. */
+            std::vector<std::unique_ptr<table>> tables;
+
+            /** Number of entries in the current table. */
+            std::size_t size = 0;
+
+            std::vector<std::unique_ptr<char[]>> chunks;
+            std::size_t chunk_used = 0;
+            std::size_t chunk_capacity = 0;
+
+            /** Reserves space for characters. Requires the lock. */
+            char* allocate(std::size_t n)
+            {
+                if (chunks.empty() || chunk_capacity - chunk_used < n) {
+                    // oversized strings get a chunk of their own
+                    std::size_t capacity = chunks.empty() ? initial_chunk_size : std::min(2 * chunk_capacity, chunk_size);
+                    chunk_capacity = std::max(capacity, n);
+                    chunk_used = 0;
+                    chunks.emplace_back(new char[chunk_capacity]);
+                }
+
+                char* p = chunks.back().get() + chunk_used;
+                chunk_used += n;
+                return p;
+            }
+
+            /** Publishes an ordinal in the hash table. Requires the lock. */
+            void insert(std::uint64_t hash, std::uint32_t index)
+            {
+                table* t = current.load(std::memory_order_relaxed);
+                if (t == nullptr || 2 * (size + 1) > t->mask + 1) {
+                    t = grow(t);
+                }
+                place(*t, (hash >> 32 << 32) | (static_cast<std::uint64_t>(index) + 1), std::memory_order_release);
+                ++size;
+            }
+
+        private:
+            table* grow(table* old)
+            {
+                std::size_t capacity = old == nullptr ? initial_table_size : 2 * (old->mask + 1);
+                std::unique_ptr<table> t(new table(capacity));
+                if (old != nullptr) {
+                    for (std::size_t k = 0; k <= old->mask; ++k) {
+                        std::uint64_t value = old->slots[k].load(std::memory_order_relaxed);
+                        if (value != 0) {
+                            place(*t, value, std::memory_order_relaxed);
+                        }
+                    }
+                }
+
+                // slots of the new table become visible together with the table
+                table* p = t.get();
+                tables.push_back(std::move(t));
+                current.store(p, std::memory_order_release);
+                return p;
+            }
+
+            static void place(table& t, std::uint64_t value, std::memory_order order)
+            {
+                for (std::size_t k = static_cast<std::size_t>(value >> 32) & t.mask; ; k = (k + 1) & t.mask) {
+                    if (t.slots[k].load(std::memory_order_relaxed) == 0) {
+                        t.slots[k].store(value, order);
+                        return;
+                    }
+                }
+            }
+        };
+#if defined(_MSC_VER)
+#pragma warning(pop)
+#endif
+
+        constexpr static std::size_t shard_count = 64;
+        constexpr static std::size_t initial_table_size = 64;
+        constexpr static std::size_t chunk_size = 64 * 1024;
+        constexpr static std::size_t initial_chunk_size = 256;
+
+        /** Entries are stored in segments of doubling size, segment k holding `segment_base << k` entries. */
+        constexpr static unsigned int segment_shift = 10;
+        constexpr static std::size_t segment_base = std::size_t(1) << segment_shift;
+        constexpr static std::size_t segment_count = 32 - segment_shift + 1;
+        constexpr static std::uint32_t max_count = 0xffffffffu;
+
+        static unsigned int floor_log2(std::size_t value)
+        {
+            unsigned int n = 0;
+            while (value >>= 1) {
+                ++n;
+            }
+            return n;
+        }
+
+        bool find(const table* t, std::uint64_t hash, const std::string_view& str, std::uint32_t& index) const
+        {
+            if (t == nullptr) {
+                return false;
+            }
+
+            std::uint64_t upper = hash >> 32;
+            for (std::size_t k = static_cast<std::size_t>(upper) & t->mask; ; k = (k + 1) & t->mask) {
+                std::uint64_t value = t->slots[k].load(std::memory_order_acquire);
+                if (value == 0) {
+                    return false;
+                }
+                if ((value >> 32) == upper) {
+                    std::uint32_t i = static_cast<std::uint32_t>(value) - 1;
+                    if (this->str(interned_string(i)) == str) {
+                        index = i;
+                        return true;
+                    }
+                }
+            }
+        }
+
+        const entry& entry_at(std::uint32_t index) const
+        {
+            unsigned int k = floor_log2((index >> segment_shift) + 1);
+            const entry* segment = _segments[k].load(std::memory_order_acquire);
+            return segment[index - segment_base * ((std::size_t(1) << k) - 1)];
+        }
+
+        entry& entry_for_write(std::uint32_t index)
+        {
+            unsigned int k = floor_log2((index >> segment_shift) + 1);
+            entry* segment = _segments[k].load(std::memory_order_acquire);
+            if (segment == nullptr) {
+                // threads in different shards may race to allocate the same segment
+                entry* fresh = new entry[segment_base << k];
+                if (_segments[k].compare_exchange_strong(segment, fresh, std::memory_order_acq_rel, std::memory_order_acquire)) {
+                    segment = fresh;
+                } else {
+                    delete[] fresh;
+                }
+            }
+            return segment[index - segment_base * ((std::size_t(1) << k) - 1)];
+        }
+
+        /** Shards are allocated separately, such that types that embed the store are not over-aligned. */
+        std::unique_ptr<shard[]> _shards{ new shard[shard_count] };
+        std::atomic<entry*> _segments[segment_count] = {};
+        std::atomic<std::uint32_t> _count{ 0 };
+    };
+}
@@ -0,0 +1,159 @@
+/**
+ * murify: Efficient in-memory compression for URLs
+ * @see https://github.com/hunyadi/murify
+ *
+ * Copyright (c) 2024 Levente Hunyadi
+ *
+ * This work is licensed under the terms of the MIT license.
+ * For a copy, see <https://opensource.org/licenses/MIT>.
+ */
+
+#pragma once
+#include "interned_string.hpp"
+#include "concurrent_interned_store.hpp"
+#include "frozen_interned_store.hpp"
+
+#include <string_view>
+#include <vector>
+#include <type_traits>
+#include <utility>
+#include <stdexcept>
+#include <cstddef>
+
+namespace murify
+{
+    /**
+     * Dictionaries of interned strings, each scoped to a context such as a host or a query key.
+     *
+     * Each context has a store of interned strings of its own, whose ordinals start from zero, such that a context
+     * with a small vocabulary references its strings with indices embedded into the control byte, however many
+     * strings other contexts hold. Contexts are identified by name, and are looked up in a store of their own.
+     *
+     * With a read-only `Store`, contexts are an immutable snapshot, which may be shared across threads without
+     * synchronization. Contexts cannot be added by multiple threads simultaneously, and `concurrent_interned_store`
+     * is not supported; a compactor that has been frozen shares its contexts instead.
+     */
+    template<typename Store>
+    struct context_store
+    {
+        static_assert(!std::is_same_v<Store, concurrent_interned_store>, "contexts cannot be added concurrently, freeze the compactor instead");
+
+        /** Contexts can be added unless the store of the compactor is read-only. */
+        constexpr static bool read_only = Store::read_only;
+
+        /** The store of interned strings of a single context. */
+        using scope_type = std::conditional_t<read_only, frozen_interned_store, interned_store>;
+
+        /** A reference to the store of a context, through which strings are interned unless it is read-only. */
+        using scope_reference = std::conditional_t<read_only, const scope_type&, scope_type&>;
+
+        context_store() = default;
+
+        context_store(const context_store&) = delete;
+        context_store& operator=(const context_store&) = delete;
+        context_store(context_store&&) = default;
+        context_store& operator=(context_store&&) = default;
+
+        /** Takes a snapshot of the contexts in another context store, preserving the ordinals of strings. */
+        template<typename Other>
+        explicit context_store(const context_store<Other>& other)
+            : _names(other._names)
+        {
+            _scopes.reserve(other._scopes.size());
+            for (auto&& scope : other._scopes) {
+                _scopes.emplace_back(scope);
+            }
+        }
+
+        /**
+         * Uses existing stores of contexts, e.g. stores loaded from a dictionary file.
+         *
+         * @param names The names of contexts, whose ordinals are indices into `scopes`.
+         * @param scopes The store of each context.
+         */
+        context_store(scope_type&& names, std::vector<scope_type>&& scopes)
+            : _names(std::move(names)), _scopes(std::move(scopes))
+        {
+            if (_names.count() != _scopes.size()) {
+                throw std::invalid_argument("mismatch in number of contexts");
+            }
+        }
+
+        /** Number of contexts. */
+        std::size_t count() const
+        {
+            return _scopes.size();
+        }
+
+        /** The names of contexts, whose ordinals identify the store of each context. */
+        const scope_type& names() const
+        {
+            return _names;
+        }
+
+        /** The store of a context, or an empty store if the context has not been seen. */
+        const scope_type& find(const std::string_view& context) const
+        {
+            interned_string s;
+            return _names.find(context, s) ? _scopes[s.index()] : empty();
+        }
+
+        /** The store of a context, which is added unless the context store is read-only. */
+        scope_reference scope(const std::string_view& context)
+        {
+            if constexpr (read_only) {
+                return find(context);
+            } else {
+                interned_string s = _names.intern(context);
+                if (s.index() == _scopes.size()) {
+                    _scopes.emplace_back();
+                }
+                return _scopes[s.index()];
+            }
+        }
+
+        /**
+         * Interns the strings of each context of another context store, in the order they were added.
+         *
+         * Merging the contexts collected from consecutive ranges of URLs in order assigns the ordinals that compacting
+         * all URLs with this context store would assign.
+         */
+        template<typename Other>
+        void merge(const context_store<Other>& other)
+        {
+            static_assert(!read_only, "contexts cannot be added to a read-only context store");
+            std::size_t index = 0;
+            for (auto it = other._names.begin(); it != other._names.end(); ++it, ++index) {
+                scope_type& target = scope(*it);
+                for (auto&& str : other._scopes[index]) {
+                    target.intern(str);
+                }
+            }
+        }
+
+        /** Deallocates and removes all contexts. */
+        void clear()
+        {
+            _names.clear();
+            _scopes.clear();
+        }
+
+    private:
+        template<typename Other>
+        friend struct context_store;
+
+        static const scope_type& empty()
+        {
+            if constexpr (read_only) {
+                static const scope_type store{ interned_store() };
+                return store;
+            } else {
+                static const scope_type store;
+                return store;
+            }
+        }
+
+        scope_type _names;
+        std::vector<scope_type> _scopes;
+    };
+}
@@ -0,0 +1,282 @@
+/**
+ * murify: Efficient in-memory compression for URLs
+ * @see https://github.com/hunyadi/murify
+ *
+ * Copyright (c) 2024 Levente Hunyadi
+ *
+ * This work is licensed under the terms of the MIT license.
+ * For a copy, see <https://opensource.org/licenses/MIT>.
+ */
+
+#pragma once
+#include "simd.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace murify
+{
+    namespace detail
+    {
+        /**
+         * Vectorized base64url kernels.
+         *
+         * Kernels process the longest prefix of the input that fills whole vectors, and return the number of input
+         * elements consumed; the caller processes the rest with scalar code. Decoding validates characters and maps them to
+         * 6-bit values with lookups by high and low nibble, and packs 4 values into 3 bytes with multiply-add
+         * instructions. Encoding spreads 3 bytes into 4 values with a shuffle and multiplications, and maps values to
+         * characters with a shuffle-based lookup of offsets.
+         */
+        namespace base64_simd
+        {
+#if defined(MURIFY_SIMD_X86)
+            /**
+             * Classes of characters by high nibble (bits 0 to 6), and lower nibbles that are invalid with each high
+             * nibble. A character is valid if the classes of its high and low nibble are disjoint.
+             */
+            constexpr char invalid_hi[16] = {
+                -1, -1, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, -1, -1, -1, -1, -1, -1, -1, -1 };
+            constexpr char invalid_lo[16] = {
+                0x2b, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x07, 0x57, 0x57, 0x55, 0x57, 0x47 };
+
+            /** Offset that maps a character to its 6-bit value by high nibble; '_' is handled separately. */
+            constexpr char offset_hi[16] = {
+                0, 0, 62 - '-', 52 - '0', -'A', -'A', 26 - 'a', 26 - 'a', 0, 0, 0, 0, 0, 0, 0, 0 };
+
+            MURIFY_TARGET_AVX2 inline __m256i broadcast(const char (&table)[16])
+            {
+                return _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(table)));
+            }
+
+            MURIFY_TARGET_AVX2 inline __m256i to_values(__m256i c, bool& valid)
+            {
+                __m256i hi = _mm256_and_si256(_mm256_srli_epi16(c, 4), _mm256_set1_epi8(0x0f));
+                __m256i lo = _mm256_and_si256(c, _mm256_set1_epi8(0x0f));
+                valid = _mm256_testz_si256(_mm256_shuffle_epi8(broadcast(invalid_hi), hi), _mm256_shuffle_epi8(broadcast(invalid_lo), lo)) != 0;
+
+                __m256i offset = _mm256_shuffle_epi8(broadcast(offset_hi), hi);
+                offset = _mm256_blendv_epi8(offset, _mm256_set1_epi8(63 - '_'), _mm256_cmpeq_epi8(c, _mm256_set1_epi8('_')));
+                return _mm256_add_epi8(c, offset);
+            }
+
+            MURIFY_TARGET_AVX2 inline std::size_t decode_avx2(const char* input, std::size_t size, std::byte* output, bool& valid)
+            {
+                // output bytes may alias the flag, which is set only once the loop has finished
+                bool ok = true;
+                std::size_t i = 0;
+                for (; i + 32 <= size; i += 32, output += 24) {
+                    __m256i values = to_values(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(input + i)), ok);
+                    if (!ok) {
+                        break;
+                    }
+
+                    // merge 4 values of 6 bits into 3 bytes in each 32-bit element, most significant byte first
+                    __m256i pairs = _mm256_maddubs_epi16(values, _mm256_set1_epi32(0x01400140));
+                    __m256i packed = _mm256_madd_epi16(pairs, _mm256_set1_epi32(0x00011000));
+                    packed = _mm256_shuffle_epi8(packed, _mm256_setr_epi8(
+                        2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,
+                        2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1));
+                    packed = _mm256_permutevar8x32_epi32(packed, _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 3, 7));
+
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(output), _mm256_castsi256_si128(packed));
+                    _mm_storel_epi64(reinterpret_cast<__m128i*>(output + 16), _mm256_extracti128_si256(packed, 1));
+                }
+                valid = ok;
+                return i;
+            }
+
+            MURIFY_TARGET_AVX2 inline std::size_t validate_avx2(const char* input, std::size_t size, bool& valid)
+            {
+                valid = true;
+                std::size_t i = 0;
+                for (; i + 32 <= size; i += 32) {
+                    to_values(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(input + i)), valid);
+                    if (!valid) {
+                        return i;
+                    }
+                }
+                return i;
+            }
+
+            MURIFY_TARGET_AVX2 inline std::size_t encode_avx2(const std::byte* input, std::size_t size, char* output)
+            {
+                // each iteration reads 28 bytes (two overlapping 16-byte loads), and consumes 24 bytes
+                std::size_t i = 0;
+                for (; i + 28 <= size; i += 24, output += 32) {
+                    __m128i lo = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input + i));
+                    __m128i hi = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input + i + 12));
+                    __m256i v = _mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1);
+
+                    // spread 3 bytes into 4 values of 6 bits, each in a byte of its own
+                    v = _mm256_shuffle_epi8(v, _mm256_setr_epi8(
+                        1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10,
+                        1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10));
+                    __m256i t0 = _mm256_mulhi_epu16(_mm256_and_si256(v, _mm256_set1_epi32(0x0fc0fc00)), _mm256_set1_epi32(0x04000040));
+                    __m256i t1 = _mm256_mullo_epi16(_mm256_and_si256(v, _mm256_set1_epi32(0x003f03f0)), _mm256_set1_epi32(0x01000010));
+                    __m256i values = _mm256_or_si256(t0, t1);
+
+                    // 0..25 -> 0, 26..51 -> 1, 52..61 -> 2..11, 62 -> 12, 63 -> 13
+                    __m256i index = _mm256_subs_epu8(values, _mm256_set1_epi8(51));
+                    index = _mm256_sub_epi8(index, _mm256_cmpgt_epi8(values, _mm256_set1_epi8(25)));
+                    __m256i offsets = _mm256_setr_epi8(
+                        'A', 'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '-' - 62, '_' - 63, 0, 0,
+                        'A', 'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '-' - 62, '_' - 63, 0, 0);
+                    __m256i chars = _mm256_add_epi8(values, _mm256_shuffle_epi8(offsets, index));
+                    _mm256_storeu_si256(reinterpret_cast<__m256i*>(output), chars);
+                }
+                return i;
+            }
+
+            MURIFY_TARGET_SSE41 inline __m128i load(const char (&table)[16])
+            {
+                return _mm_loadu_si128(reinterpret_cast<const __m128i*>(table));
+            }
+
+            MURIFY_TARGET_SSE41 inline __m128i to_values(__m128i c, bool& valid)
+            {
+                __m128i hi = _mm_and_si128(_mm_srli_epi16(c, 4), _mm_set1_epi8(0x0f));
+                __m128i lo = _mm_and_si128(c, _mm_set1_epi8(0x0f));
+                valid = _mm_testz_si128(_mm_shuffle_epi8(load(invalid_hi), hi), _mm_shuffle_epi8(load(invalid_lo), lo)) != 0;
+
+                __m128i offset = _mm_shuffle_epi8(load(offset_hi), hi);
+                offset = _mm_blendv_epi8(offset, _mm_set1_epi8(63 - '_'), _mm_cmpeq_epi8(c, _mm_set1_epi8('_')));
+                return _mm_add_epi8(c, offset);
+            }
+
+            MURIFY_TARGET_SSE41 inline std::size_t decode_sse41(const char* input, std::size_t size, std::byte* output, bool& valid)
+            {
+                // output bytes may alias the flag, which is set only once the loop has finished
+                bool ok = true;
+                std::size_t i = 0;
+                for (; i + 16 <= size; i += 16, output += 12) {
+                    __m128i values = to_values(_mm_loadu_si128(reinterpret_cast<const __m128i*>(input + i)), ok);
+                    if (!ok) {
+                        break;
+                    }
+
+                    __m128i pairs = _mm_maddubs_epi16(values, _mm_set1_epi32(0x01400140));
+                    __m128i packed = _mm_madd_epi16(pairs, _mm_set1_epi32(0x00011000));
+                    packed = _mm_shuffle_epi8(packed, _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1));
+
+                    _mm_storel_epi64(reinterpret_cast<__m128i*>(output), packed);
+                    std::uint32_t last = static_cast<std::uint32_t>(_mm_extract_epi32(packed, 2));
+                    std::memcpy(output + 8, &last, 4);
+                }
+                valid = ok;
+                return i;
+            }
+
+            MURIFY_TARGET_SSE41 inline std::size_t validate_sse41(const char* input, std::size_t size, bool& valid)
+            {
+                valid = true;
+                std::size_t i = 0;
+                for (; i + 16 <= size; i += 16) {
+                    to_values(_mm_loadu_si128(reinterpret_cast<const __m128i*>(input + i)), valid);
+                    if (!valid) {
+                        return i;
+                    }
+                }
+                return i;
+            }
+
+            MURIFY_TARGET_SSE41 inline std::size_t encode_sse41(const std::byte* input, std::size_t size, char* output)
+            {
+                // each iteration reads 16 bytes, and consumes 12 bytes
+                std::size_t i = 0;
+                for (; i + 16 <= size; i += 12, output += 16) {
+                    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input + i));
+                    v = _mm_shuffle_epi8(v, _mm_setr_epi8(1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10));
+                    __m128i t0 = _mm_mulhi_epu16(_mm_and_si128(v, _mm_set1_epi32(0x0fc0fc00)), _mm_set1_epi32(0x04000040));
+                    __m128i t1 = _mm_mullo_epi16(_mm_and_si128(v, _mm_set1_epi32(0x003f03f0)), _mm_set1_epi32(0x01000010));
+                    __m128i values = _mm_or_si128(t0, t1);
+
+                    __m128i index = _mm_subs_epu8(values, _mm_set1_epi8(51));
+                    index = _mm_sub_epi8(index, _mm_cmpgt_epi8(values, _mm_set1_epi8(25)));
+                    __m128i offsets = _mm_setr_epi8(
+                        'A', 'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '-' - 62, '_' - 63, 0, 0);
+                    __m128i chars = _mm_add_epi8(values, _mm_shuffle_epi8(offsets, index));
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(output), chars);
+                }
+                return i;
+            }
+#endif
+
+            /** Decodes the longest prefix that fills whole vectors, and returns the number of characters consumed. */
+            inline std::size_t decode(const char* input, std::size_t size, std::byte* output, bool& valid)
+            {
+                valid = true;
+#if defined(MURIFY_SIMD_X86)
+                if (size >= 16) {
+                    switch (simd_support()) {
+                    case simd_level::avx2:
+                        if (size >= 32) {
+                            return decode_avx2(input, size, output, valid);
+                        }
+                        return decode_sse41(input, size, output, valid);
+                    case simd_level::sse41:
+                        return decode_sse41(input, size, output, valid);
+                    default:
+                        break;
+                    }
+                }
+#else
+                (void)input;
+                (void)size;
+                (void)output;
+#endif
+                return 0;
+            }
+
+            /** Validates the longest prefix that fills whole vectors, and returns the number of characters consumed. */
+            inline std::size_t validate(const char* input, std::size_t size, bool& valid)
+            {
+                valid = true;
+#if defined(MURIFY_SIMD_X86)
+                if (size >= 16) {
+                    switch (simd_support()) {
+                    case simd_level::avx2:
+                        if (size >= 32) {
+                            return validate_avx2(input, size, valid);
+                        }
+                        return validate_sse41(input, size, valid);
+                    case simd_level::sse41:
+                        return validate_sse41(input, size, valid);
+                    default:
+                        break;
+                    }
+                }
+#else
+                (void)input;
+                (void)size;
+#endif
+                return 0;
+            }
+
+            /** Encodes the longest prefix that fills whole vectors, and returns the number of bytes consumed. */
+            inline std::size_t encode(const std::byte* input, std::size_t size, char* output)
+            {
+#if defined(MURIFY_SIMD_X86)
+                if (size >= 16) {
+                    switch (simd_support()) {
+                    case simd_level::avx2:
+                        if (size >= 28) {
+                            return encode_avx2(input, size, output);
+                        }
+                        return encode_sse41(input, size, output);
+                    case simd_level::sse41:
+                        return encode_sse41(input, size, output);
+                    default:
+                        break;
+                    }
+                }
+#else
+                (void)input;
+                (void)size;
+                (void)output;
+#endif
+                return 0;
+            }
+        }
+    }
+}
@@ -0,0 +1,175 @@
+/**
+ * murify: Efficient in-memory compression for URLs
+ * @see https://github.com/hunyadi/murify
+ *
+ * Copyright (c) 2024 Levente Hunyadi
+ *
+ * This work is licensed under the terms of the MIT license.
+ * For a copy, see <https://opensource.org/licenses/MIT>.
+ */
+
+#pragma once
+#include <string_view>
+#include <cstddef>
+#include <cstdint>
+
+namespace murify
+{
+    namespace detail
+    {
+        /**
+         * Tokens common to URLs across sites, in order of decreasing expected frequency.
+         *
+         * A built-in token is written as its index in this table, which takes two bytes with the control byte, and
+         * needs no entry in the store of a compactor. Tokens may be appended, but changing or reordering tokens breaks
+         * existing compact representations. At most 256 tokens fit into the index byte.
+         */
+        constexpr std::string_view builtin_tokens[] = {
+            "www", "api", "com", "v1", "v2", "id", "page", "search", "index.html", "utm_source", "utm_medium",
+            "utm_campaign", "utm_content", "utm_term", "http", "https", "org", "net", "en", "static", "assets",
+            "images", "img", "css", "js", "user", "users", "login", "auth", "token", "callback", "redirect_uri",
+            "client_id", "response_type", "code", "state", "scope", "ref", "lang", "sort", "order", "limit", "offset",
+            "size", "type", "format", "json", "html", "true", "false", "null", "category", "product", "products",
+            "item", "items", "view", "default", "home", "gclid", "fbclid", "msclkid", "v3", "v4", "index.php",
+            "index.htm", "favicon.ico", "robots.txt", "sitemap.xml", "main.js", "style.css", "en-us", "en-gb", "de",
+            "fr", "es", "it", "ja", "zh", "pt", "ru", "nl", "data", "info", "content", "public", "media", "video",
+            "videos", "image", "download", "downloads", "upload", "uploads", "files", "file", "docs", "doc", "account",
+            "accounts", "profile", "settings", "admin", "dashboard", "cart", "checkout", "shop", "store", "logout",
+            "oauth", "redirect", "blog", "news", "article", "articles", "post", "posts", "tag", "tags", "list",
+            "detail", "details", "new", "edit", "about", "contact", "help", "width", "height", "quality", "crop",
+            "fit", "auto", "webp", "png", "jpg", "jpeg", "gif", "svg", "mp4", "pdf", "thumb", "thumbnail", "preview",
+            "start", "end", "from", "to", "date", "time", "year", "month", "day", "count", "max", "min", "per_page",
+            "page_size", "cursor", "next", "prev", "source", "medium", "campaign", "keyword", "keywords", "filter",
+            "filters", "fields", "include", "expand", "action", "method", "mode", "session", "sid", "uid", "pid",
+            "cid", "ts", "ver", "version", "rev", "hl", "gl", "locale", "region", "country", "currency", "price",
+            "color", "brand", "event", "events", "track", "share", "embed", "feed", "rss", "amp", "wp-content",
+            "wp-includes", "wp-admin", "wp-json", "app", "apps", "cdn", "health", "status", "metrics", "graphql",
+            "rest", "rpc", "internal", "service", "services", "beta", "latest", "stable", "orders", "comments",
+            "comment", "config", "resources", "resource", "objects", "object", "buckets", "bucket", "keys", "key",
+            "value", "name", "email", "lat", "lng", "lon", "zoom", "tile", "tiles", "map", "maps", "debug", "test",
+            "dev", "prod", "staging", "cache", "utf-8", "en_us", "utm_id", "mc_cid", "mc_eid"
+        };
+
+        constexpr std::size_t builtin_token_count = sizeof(builtin_tokens) / sizeof(builtin_tokens[0]);
+
+        static_assert(builtin_token_count <= 256, "index of built-in token must fit into a byte");
+
+        constexpr std::size_t get_max_builtin_token_size()
+        {
+            std::size_t size = 0;
+            for (const std::string_view& token : builtin_tokens) {
+                size = token.size() > size ? token.size() : size;
+            }
+            return size;
+        }
+
+        /** Longest built-in token, such that longer strings skip the lookup. */
+        constexpr std::size_t max_builtin_token_size = get_max_builtin_token_size();
+
+        /**
+         * A perfect hash of the built-in tokens.
+         *
+         * Tokens are distributed into buckets by their hash, and each bucket gets a seed such that all tokens in the
+         * bucket map to distinct free slots when the seed is mixed into their hash. Looking up a string takes a single
+         * hash computation, two table reads and a string comparison.
+         *
+         * Seeds are found offline with `murify-builtin-table` (`tools/builtin_table.cpp`), which prints the tables
+         * below, such that compilers need not search for them within their limits on constant evaluation.
+         */
+        struct builtin_table
+        {
+            constexpr static std::size_t bucket_bits = 7;
+            constexpr static std::size_t slot_bits = 9;
+            constexpr static std::size_t bucket_count = std::size_t{ 1 } << bucket_bits;
+            constexpr static std::size_t slot_count = std::size_t{ 1 } << slot_bits;
+
+            static_assert(builtin_token_count < slot_count, "too many built-in tokens for hash table");
+
+            /** FNV-1a hash of a string. */
+            constexpr static std::uint64_t hash(const std::string_view& str)
+            {
+                std::uint64_t h = 0xcbf29ce484222325ull;
+                for (char c : str) {
+                    h ^= static_cast<unsigned char>(c);
+                    h *= 0x100000001b3ull;
+                }
+                return h;
+            }
+
+            constexpr static std::size_t bucket(std::uint64_t h)
+            {
+                return static_cast<std::size_t>((h * 0x9e3779b97f4a7c15ull) >> (64 - bucket_bits));
+            }
+
+            constexpr static std::size_t slot(std::uint64_t h, std::uint16_t seed)
+            {
+                std::uint64_t x = h ^ (static_cast<std::uint64_t>(seed) * 0x9e3779b97f4a7c15ull);
+                x ^= x >> 31;
+                x *= 0xbf58476d1ce4e5b9ull;
+                return static_cast<std::size_t>(x >> (64 - slot_bits));
+            }
+
+            /** Seed of each bucket. */
+            constexpr static std::uint16_t seeds[bucket_count] = {
+                2, 0, 2, 0, 0, 0, 2, 1, 0, 1, 2, 0, 0, 1, 0, 0,
+                0, 0, 0, 1, 0, 0, 0, 0, 0, 0, 2, 0, 1, 0, 0, 2,
+                0, 1, 0, 2, 0, 0, 0, 0, 1, 0, 0, 0, 5, 0, 0, 2,
+                0, 3, 0, 0, 0, 1, 0, 0, 0, 1, 0, 0, 3, 0, 1, 7,
+                1, 0, 0, 2, 10, 1, 2, 0, 0, 1, 0, 1, 0, 0, 0, 0,
+                2, 4, 0, 7, 0, 0, 1, 3, 4, 0, 0, 1, 3, 0, 3, 0,
+                0, 3, 0, 1, 0, 0, 5, 0, 0, 0, 0, 1, 3, 0, 2, 3,
+                6, 2, 0, 2, 3, 0, 4, 1, 0, 0, 3, 0, 0, 0, 0, 5
+            };
+            /** One more than the index of the token in each slot, or 0 for a free slot. */
+            constexpr static std::uint16_t slots[slot_count] = {
+                0, 0, 238, 0, 144, 169, 152, 5, 128, 0, 230, 0, 0, 113, 1, 0,
+                84, 30, 23, 71, 0, 0, 116, 0, 86, 24, 0, 146, 131, 140, 0, 0,
+                0, 233, 36, 122, 0, 0, 94, 208, 0, 0, 31, 0, 0, 204, 0, 0,
+                158, 183, 8, 0, 0, 0, 222, 0, 0, 65, 0, 167, 0, 32, 0, 0,
+                0, 0, 97, 0, 175, 220, 197, 0, 68, 0, 0, 0, 176, 0, 99, 0,
+                154, 223, 0, 25, 0, 109, 240, 0, 0, 189, 0, 0, 73, 232, 0, 0,
+                0, 0, 0, 214, 87, 132, 0, 9, 14, 157, 0, 217, 96, 0, 66, 0,
+                0, 246, 182, 0, 172, 0, 0, 0, 0, 163, 19, 0, 138, 145, 0, 153,
+                43, 196, 0, 0, 0, 0, 0, 0, 0, 6, 0, 188, 0, 126, 0, 200,
+                0, 0, 11, 0, 0, 63, 0, 22, 0, 64, 48, 139, 0, 133, 0, 83,
+                0, 0, 93, 46, 247, 105, 249, 0, 0, 228, 0, 0, 199, 59, 0, 252,
+                0, 0, 69, 0, 104, 168, 101, 0, 55, 0, 0, 0, 0, 0, 241, 0,
+                0, 7, 0, 0, 0, 74, 0, 234, 0, 235, 0, 225, 184, 37, 110, 203,
+                29, 0, 107, 0, 61, 159, 0, 177, 0, 171, 0, 218, 0, 0, 0, 0,
+                205, 76, 21, 0, 0, 0, 0, 0, 0, 0, 52, 39, 155, 3, 85, 244,
+                0, 0, 44, 236, 0, 0, 165, 0, 88, 0, 0, 26, 170, 103, 149, 50,
+                0, 0, 0, 191, 0, 114, 186, 0, 127, 108, 0, 118, 33, 0, 221, 141,
+                0, 198, 0, 0, 0, 0, 190, 124, 219, 13, 80, 179, 180, 0, 194, 0,
+                129, 89, 0, 18, 0, 34, 136, 78, 106, 130, 67, 0, 0, 0, 0, 17,
+                72, 0, 0, 0, 0, 0, 0, 27, 0, 121, 0, 0, 0, 0, 0, 120,
+                0, 0, 210, 123, 0, 0, 0, 49, 0, 0, 0, 0, 0, 0, 0, 111,
+                181, 253, 187, 0, 0, 56, 0, 202, 242, 0, 0, 0, 0, 0, 2, 117,
+                119, 137, 115, 178, 250, 224, 0, 0, 206, 142, 0, 229, 0, 0, 0, 0,
+                0, 0, 0, 0, 213, 0, 91, 0, 35, 0, 0, 0, 0, 0, 81, 100,
+                28, 0, 0, 90, 42, 40, 0, 0, 92, 0, 160, 192, 156, 0, 0, 0,
+                166, 15, 0, 231, 0, 79, 0, 245, 0, 112, 0, 41, 98, 0, 77, 0,
+                251, 0, 0, 0, 162, 143, 0, 57, 0, 0, 0, 102, 164, 0, 95, 4,
+                237, 10, 185, 0, 135, 148, 82, 51, 0, 201, 0, 0, 70, 0, 20, 0,
+                0, 151, 0, 0, 134, 174, 60, 193, 0, 0, 45, 125, 0, 211, 0, 248,
+                0, 0, 53, 0, 0, 0, 0, 58, 0, 0, 0, 38, 0, 0, 0, 150,
+                0, 0, 0, 47, 207, 0, 0, 161, 12, 62, 226, 75, 147, 209, 243, 216,
+                0, 212, 0, 195, 0, 227, 0, 0, 16, 0, 239, 215, 173, 54, 0, 0
+            };
+        };
+
+        /** Looks up a string among the built-in tokens, and sets its ordinal if found. */
+        inline bool find_builtin_token(const std::string_view& str, std::uint32_t& index)
+        {
+            if (str.size() > max_builtin_token_size) {
+                return false;
+            }
+            std::uint64_t h = builtin_table::hash(str);
+            std::uint16_t entry = builtin_table::slots[builtin_table::slot(h, builtin_table::seeds[builtin_table::bucket(h)])];
+            if (entry == 0 || builtin_tokens[entry - 1] != str) {
+                return false;
+            }
+            index = entry - 1u;
+            return true;
+        }
+    }
+}
@@ -0,0 +1,163 @@
+/**
+ * murify: Efficient in-memory compression for URLs
+ * @see https://github.com/hunyadi/murify
+ *
+ * Copyright (c) 2024 Levente Hunyadi
+ *
+ * This work is licensed under the terms of the MIT license.
+ * For a copy, see <https://opensource.org/licenses/MIT>.
+ */
+
+#pragma once
+#include "simd.hpp"
+
+#include <string_view>
+#include <cstddef>
+#include <cstdint>
+
+namespace murify
+{
+    namespace detail
+    {
+        inline unsigned int count_trailing_zeros(std::uint32_t bits)
+        {
+#if defined(__GNUC__)
+            return static_cast<unsigned int>(__builtin_ctz(bits));
+#elif defined(_MSC_VER)
+            unsigned long index;
+            _BitScanForward(&index, bits);
+            return static_cast<unsigned int>(index);
+#else
+            unsigned int n = 0;
+            for (; (bits & 1) == 0; bits >>= 1) {
+                ++n;
+            }
+            return n;
+#endif
+        }
+
+        /**
+         * A set of ASCII characters, such as separator characters, that finds occurrences in a string.
+         *
+         * Membership of a character is decided with two table lookups, one by its high and one by its low nibble:
+         * characters that share a high nibble form a class, and a character is in the set if the lookup by its low
+         * nibble yields its class. Vectorized scanning performs both lookups on 16 or 32 characters at once with a
+         * shuffle instruction, and builds a bitmask of positions where characters of the set occur.
+         */
+        struct char_set
+        {
+            /** A set of the characters in a null-terminated string. Characters that are not ASCII are ignored. */
+            constexpr explicit char_set(const char* chars)
+            {
+                for (const char* p = chars; *p != 0; ++p) {
+                    add(*p);
+                }
+            }
+
+            /** A set of a single character. */
+            constexpr explicit char_set(char c)
+            {
+                add(c);
+            }
+
+            /** True if the character is in the set. */
+            constexpr bool contains(char c) const
+            {
+                unsigned int u = static_cast<unsigned char>(c);
+                return u < 0x80 && (hi[u >> 4] & lo[u & 0x0f]) != 0;
+            }
+
+            /** Invokes a function with the position of each character in the string that is in the set, in order. */
+            template<typename Fn>
+            void for_each_in(const std::string_view& in, Fn&& fn) const
+            {
+                std::size_t i = 0;
+#if defined(MURIFY_SIMD_X86)
+                if (in.size() >= 16) {
+                    switch (simd_support()) {
+                    case simd_level::avx2:
+                        i = scan_avx2(in, fn);
+                        break;
+                    case simd_level::sse41:
+                        i = scan_sse41(in, fn);
+                        break;
+                    default:
+                        break;
+                    }
+                }
+#endif
+                for (; i < in.size(); ++i) {
+                    if (contains(in[i])) {
+                        fn(i);
+                    }
+                }
+            }
+
+            /** Number of characters in the string that are in the set. */
+            std::size_t count_in(const std::string_view& in) const
+            {
+                std::size_t count = 0;
+                for_each_in(in, [&count](std::size_t) { ++count; });
+                return count;
+            }
+
+        private:
+            constexpr void add(char ch)
+            {
+                unsigned int c = static_cast<unsigned char>(ch);
+                if (c < 0x80) {
+                    hi[c >> 4] = static_cast<char>(1u << (c >> 4));
+                    lo[c & 0x0f] = static_cast<char>(static_cast<unsigned char>(lo[c & 0x0f]) | (1u << (c >> 4)));
+                }
+            }
+
+#if defined(MURIFY_SIMD_X86)
+            template<typename Fn>
+            MURIFY_TARGET_AVX2 std::size_t scan_avx2(const std::string_view& in, Fn& fn) const
+            {
+                __m256i hi_table = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(hi)));
+                __m256i lo_table = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(lo)));
+                std::size_t i = 0;
+                for (; i + 32 <= in.size(); i += 32) {
+                    __m256i c = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in.data() + i));
+
+                    // the shuffle yields zero for bytes with the most significant bit set, i.e. non-ASCII characters
+                    __m256i h = _mm256_shuffle_epi8(hi_table, _mm256_and_si256(_mm256_srli_epi16(c, 4), _mm256_set1_epi8(0x0f)));
+                    __m256i l = _mm256_shuffle_epi8(lo_table, c);
+                    __m256i none = _mm256_cmpeq_epi8(_mm256_and_si256(h, l), _mm256_setzero_si256());
+                    std::uint32_t mask = ~static_cast<std::uint32_t>(_mm256_movemask_epi8(none));
+                    for (; mask != 0; mask &= mask - 1) {
+                        fn(i + count_trailing_zeros(mask));
+                    }
+                }
+                return i;
+            }
+
+            template<typename Fn>
+            MURIFY_TARGET_SSE41 std::size_t scan_sse41(const std::string_view& in, Fn& fn) const
+            {
+                __m128i hi_table = _mm_loadu_si128(reinterpret_cast<const __m128i*>(hi));
+                __m128i lo_table = _mm_loadu_si128(reinterpret_cast<const __m128i*>(lo));
+                std::size_t i = 0;
+                for (; i + 16 <= in.size(); i += 16) {
+                    __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in.data() + i));
+                    __m128i h = _mm_shuffle_epi8(hi_table, _mm_and_si128(_mm_srli_epi16(c, 4), _mm_set1_epi8(0x0f)));
+                    __m128i l = _mm_shuffle_epi8(lo_table, c);
+                    __m128i none = _mm_cmpeq_epi8(_mm_and_si128(h, l), _mm_setzero_si128());
+                    std::uint32_t mask = ~static_cast<std::uint32_t>(_mm_movemask_epi8(none)) & 0xffff;
+                    for (; mask != 0; mask &= mask - 1) {
+                        fn(i + count_trailing_zeros(mask));
+                    }
+                }
+                return i;
+            }
+#endif
+
+            /** Class of characters with the given high nibble, or zero if no character in the set has it. */
+            char hi[16] = {};
+
+            /** Classes of characters in the set with the given low nibble. */
+            char lo[16] = {};
+        };
+    }
+}
@@ -0,0 +1,212 @@
+/**
+ * murify: Efficient in-memory compression for URLs
+ * @see https://github.com/hunyadi/murify
+ *
+ * Copyright (c) 2024 Levente Hunyadi
+ *
+ * This work is licensed under the terms of the MIT license.
+ * For a copy, see <https://opensource.org/licenses/MIT>.
+ */
+
+#pragma once
+#include "simd.hpp"
+
+#include <string_view>
+#include <cstddef>
+#include <cstdint>
+
+namespace murify
+{
+    namespace detail
+    {
+        /**
+         * Character classes of a token, determined in a single scan.
+         *
+         * Each flag is set if every character of the token belongs to the class; for an empty token, all flags are set
+         * except those that require a particular shape.
+         */
+        struct token_class
+        {
+            /** Decimal digits `0-9`. */
+            static constexpr std::uint32_t digits = 1u << 0;
+            /** Lowercase letters, `_` and `-`, which are candidates for interning. */
+            static constexpr std::uint32_t internable = 1u << 1;
+            /** The base64url alphabet `A-Z`, `a-z`, `0-9`, `-` and `_`. */
+            static constexpr std::uint32_t base64 = 1u << 2;
+            /** The base64url alphabet and `.`, as in a JWT. */
+            static constexpr std::uint32_t base64_or_dot = 1u << 3;
+            /** Lowercase hexadecimal digits `0-9` and `a-f`. */
+            static constexpr std::uint32_t hex_lower = 1u << 4;
+            /** Uppercase hexadecimal digits `0-9` and `A-F`. */
+            static constexpr std::uint32_t hex_upper = 1u << 5;
+            /** A UUID of lowercase hexadecimal digits in groups of 8-4-4-4-12 separated by `-`. */
+            static constexpr std::uint32_t uuid_lower = 1u << 6;
+            /** A UUID of uppercase hexadecimal digits in groups of 8-4-4-4-12 separated by `-`. */
+            static constexpr std::uint32_t uuid_upper = 1u << 7;
+
+            std::uint32_t flags = 0;
+
+            /** Number of `.` characters in the token. */
+            std::size_t dots = 0;
+
+            /** True if all the given flags are set. */
+            bool has(std::uint32_t f) const
+            {
+                return (flags & f) == f;
+            }
+        };
+
+        inline unsigned int popcount32(std::uint32_t bits)
+        {
+#if defined(__GNUC__)
+            return static_cast<unsigned int>(__builtin_popcount(bits));
+#else
+            unsigned int n = 0;
+            for (; bits != 0; bits &= bits - 1) {
+                ++n;
+            }
+            return n;
+#endif
+        }
+
+        /** Character classes that are not reported as flags, but from which flags are derived. */
+        namespace char_class
+        {
+            /** Lowercase hexadecimal digits and `-`, the characters of a lowercase UUID. */
+            constexpr std::uint32_t uuid_lower = 1u << 6;
+            /** Uppercase hexadecimal digits and `-`, the characters of an uppercase UUID. */
+            constexpr std::uint32_t uuid_upper = 1u << 7;
+            constexpr std::uint32_t dot = 1u << 8;
+            constexpr std::uint32_t dash = 1u << 9;
+            /** Classes that hold for every character of a token when they hold for each character. */
+            constexpr std::uint32_t all = (1u << 8) - 1;
+        }
+
+        /** Classes a character belongs to, with the same bits as the flags in `token_class`. */
+        constexpr std::uint32_t classify_char(char c)
+        {
+            bool digit = c >= '0' && c <= '9';
+            bool lower = c >= 'a' && c <= 'z';
+            bool upper = c >= 'A' && c <= 'Z';
+            bool lower_hex = digit || (c >= 'a' && c <= 'f');
+            bool upper_hex = digit || (c >= 'A' && c <= 'F');
+            bool base64 = digit || lower || upper || c == '-' || c == '_';
+
+            std::uint32_t bits = 0;
+            bits |= digit ? token_class::digits : 0u;
+            bits |= lower || c == '_' || c == '-' ? token_class::internable : 0u;
+            bits |= base64 ? token_class::base64 : 0u;
+            bits |= base64 || c == '.' ? token_class::base64_or_dot : 0u;
+            bits |= lower_hex ? token_class::hex_lower : 0u;
+            bits |= upper_hex ? token_class::hex_upper : 0u;
+            bits |= lower_hex || c == '-' ? char_class::uuid_lower : 0u;
+            bits |= upper_hex || c == '-' ? char_class::uuid_upper : 0u;
+            bits |= c == '.' ? char_class::dot : 0u;
+            bits |= c == '-' ? char_class::dash : 0u;
+            return bits;
+        }
+
+        /** Classes of each character, indexed by the unsigned value of the character. */
+        struct char_class_table
+        {
+            constexpr char_class_table()
+            {
+                for (unsigned int c = 0; c < 256; ++c) {
+                    classes[c] = static_cast<std::uint16_t>(classify_char(static_cast<char>(c)));
+                }
+            }
+
+            std::uint16_t classes[256] = {};
+        };
+
+        constexpr char_class_table char_classes;
+
+#if defined(MURIFY_SIMD_X86)
+        MURIFY_TARGET_AVX2 inline std::uint32_t range_mask_avx2(__m256i c, char first, char last)
+        {
+            __m256i in_range = _mm256_and_si256(_mm256_cmpgt_epi8(c, _mm256_set1_epi8(static_cast<char>(first - 1))), _mm256_cmpgt_epi8(_mm256_set1_epi8(static_cast<char>(last + 1)), c));
+            return static_cast<std::uint32_t>(_mm256_movemask_epi8(in_range));
+        }
+
+        MURIFY_TARGET_AVX2 inline std::uint32_t equal_mask_avx2(__m256i c, char ch)
+        {
+            return static_cast<std::uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(c, _mm256_set1_epi8(ch))));
+        }
+
+        /**
+         * Classifies a block of 32 characters.
+         *
+         * @param dots Incremented by the number of `.` characters in the block.
+         * @param dashes Incremented by the number of `-` characters in the block.
+         * @return Classes that hold for every character in the block.
+         */
+        MURIFY_TARGET_AVX2 inline std::uint32_t classify_block_avx2(const char* block, std::size_t& dots, std::size_t& dashes)
+        {
+            // characters with the most significant bit set compare as negative, and fall outside all ranges
+            __m256i c = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block));
+            std::uint32_t digit = range_mask_avx2(c, '0', '9');
+            std::uint32_t lower = range_mask_avx2(c, 'a', 'z');
+            std::uint32_t upper = range_mask_avx2(c, 'A', 'Z');
+            std::uint32_t lower_hex = digit | range_mask_avx2(c, 'a', 'f');
+            std::uint32_t upper_hex = digit | range_mask_avx2(c, 'A', 'F');
+            std::uint32_t dash = equal_mask_avx2(c, '-');
+            std::uint32_t underscore = equal_mask_avx2(c, '_');
+            std::uint32_t dot = equal_mask_avx2(c, '.');
+            std::uint32_t base64 = digit | lower | upper | dash | underscore;
+
+            dots += popcount32(dot);
+            dashes += popcount32(dash);
+
+            // a class holds for the block if it holds for all 32 positions
+            std::uint32_t bits = 0;
+            bits |= digit == 0xffffffffu ? token_class::digits : 0u;
+            bits |= (lower | underscore | dash) == 0xffffffffu ? token_class::internable : 0u;
+            bits |= base64 == 0xffffffffu ? token_class::base64 : 0u;
+            bits |= (base64 | dot) == 0xffffffffu ? token_class::base64_or_dot : 0u;
+            bits |= lower_hex == 0xffffffffu ? token_class::hex_lower : 0u;
+            bits |= upper_hex == 0xffffffffu ? token_class::hex_upper : 0u;
+            bits |= (lower_hex | dash) == 0xffffffffu ? char_class::uuid_lower : 0u;
+            bits |= (upper_hex | dash) == 0xffffffffu ? char_class::uuid_upper : 0u;
+            return bits;
+        }
+#endif
+
+        /**
+         * Determines the character classes of a token in a single scan.
+         *
+         * Blocks of 32 characters are classified with vectorized range comparisons into bitmasks of positions, from
+         * which classes are derived with bitwise operations, and `.` and `-` characters are counted with population
+         * count. Remaining characters are classified with a table lookup. A token has the shape of a UUID if its
+         * characters are hexadecimal digits or `-`, and it has exactly four `-` at the expected positions.
+         */
+        inline token_class classify(const std::string_view& token)
+        {
+            std::uint32_t bits = char_class::all;
+            std::size_t dots = 0;
+            std::size_t dashes = 0;
+            std::size_t i = 0;
+#if defined(MURIFY_SIMD_X86)
+            if (token.size() >= 32 && simd_support() == simd_level::avx2) {
+                for (; i + 32 <= token.size(); i += 32) {
+                    bits &= classify_block_avx2(token.data() + i, dots, dashes);
+                }
+            }
+#endif
+            for (; i < token.size(); ++i) {
+                std::uint32_t c = char_classes.classes[static_cast<unsigned char>(token[i])];
+                bits &= c;
+                dots += (c >> 8) & 1;
+                dashes += (c >> 9) & 1;
+            }
+
+            token_class result;
+            result.flags = bits & (token_class::digits | token_class::internable | token_class::base64 | token_class::base64_or_dot | token_class::hex_lower | token_class::hex_upper);
+            if (token.size() == 36 && dashes == 4 && token[8] == '-' && token[13] == '-' && token[18] == '-' && token[23] == '-') {
+                result.flags |= (bits & char_class::uuid_lower) != 0 ? token_class::uuid_lower : 0u;
+                result.flags |= (bits & char_class::uuid_upper) != 0 ? token_class::uuid_upper : 0u;
+            }
+            result.dots = dots;
+            return result;
+        }
+    }
+}
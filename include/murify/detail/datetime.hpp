@@ -0,0 +1,291 @@
+/**
+ * murify: Efficient in-memory compression for URLs
+ * @see https://github.com/hunyadi/murify
+ *
+ * Copyright (c) 2024 Levente Hunyadi
+ *
+ * This work is licensed under the terms of the MIT license.
+ * For a copy, see <https://opensource.org/licenses/MIT>.
+ */
+
+#pragma once
+#include <string_view>
+#include <cstddef>
+#include <cstdint>
+
+namespace murify
+{
+    namespace detail
+    {
+        /** Longest textual form of a date and time, e.g. `2024-05-17T13:45:00.123456789+02:00`. */
+        constexpr std::size_t max_date_time_size = 35;
+
+        /** Most digits in the fractional part of seconds. */
+        constexpr std::size_t max_fraction_digits = 9;
+
+        /**
+         * Variations in the textual form of an ISO 8601 date and time, which make formatting reproduce a string exactly.
+         *
+         * The date is always written with a 4-digit year, and fields are zero-padded to their full width.
+         */
+        namespace date_time_form
+        {
+            /** Fields are separated with `-` and `:`, as in `2024-05-17T13:45:00`, rather than `20240517T134500`. */
+            constexpr unsigned int extended = 1u << 0;
+            /** The date is followed by `T` and a time of day with hours and minutes. */
+            constexpr unsigned int time = 1u << 1;
+            /** The time of day has seconds. */
+            constexpr unsigned int seconds = 1u << 2;
+            /** Seconds have a fractional part after `.`. */
+            constexpr unsigned int fraction = 1u << 3;
+            /** Bits that identify the time zone designator. */
+            constexpr unsigned int zone_mask = 0b11u << 4;
+            /** Time zone designator `Z`. */
+            constexpr unsigned int zone_utc = 0b01u << 4;
+            /** Time zone offset in hours and minutes, e.g. `+02:00` or `+0200`. */
+            constexpr unsigned int zone_offset = 0b10u << 4;
+            /** Time zone offset in hours, e.g. `+02`. */
+            constexpr unsigned int zone_hours = 0b11u << 4;
+            /** Time zone offset is negative, i.e. written with `-`. */
+            constexpr unsigned int negative = 1u << 6;
+            /** All of the above. */
+            constexpr unsigned int all = extended | time | seconds | fraction | zone_mask | negative;
+        }
+
+        /** A date and time of day in the proleptic Gregorian calendar, with its textual form. */
+        struct date_time
+        {
+            /** Days since 0000-01-01. */
+            std::uint32_t days = 0;
+            /** Seconds since midnight, including a leap second. */
+            std::uint32_t seconds = 0;
+            /** Fractional part of seconds, as a decimal integer of `fraction_digits` digits. */
+            std::uint32_t fraction = 0;
+            std::uint32_t fraction_digits = 0;
+            /** Absolute value of the time zone offset in minutes. */
+            std::uint32_t offset = 0;
+            /** Combination of `date_time_form` flags. */
+            unsigned int form = 0;
+        };
+
+        /** Days since 1970-01-01 of a date in the proleptic Gregorian calendar. */
+        constexpr std::int64_t days_from_civil(std::int64_t year, unsigned int month, unsigned int day)
+        {
+            // years start in March, such that the leap day is the last day of the year
+            year -= month <= 2 ? 1 : 0;
+            std::int64_t era = (year >= 0 ? year : year - 399) / 400;
+            std::uint64_t year_of_era = static_cast<std::uint64_t>(year - era * 400);
+            std::uint64_t day_of_year = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1;
+            std::uint64_t day_of_era = year_of_era * 365 + year_of_era / 4 - year_of_era / 100 + day_of_year;
+            return era * 146097 + static_cast<std::int64_t>(day_of_era) - 719468;
+        }
+
+        /** Date in the proleptic Gregorian calendar of a number of days since 1970-01-01. */
+        constexpr void civil_from_days(std::int64_t days, std::int64_t& year, unsigned int& month, unsigned int& day)
+        {
+            days += 719468;
+            std::int64_t era = (days >= 0 ? days : days - 146096) / 146097;
+            std::uint64_t day_of_era = static_cast<std::uint64_t>(days - era * 146097);
+            std::uint64_t year_of_era = (day_of_era - day_of_era / 1460 + day_of_era / 36524 - day_of_era / 146096) / 365;
+            std::uint64_t day_of_year = day_of_era - (365 * year_of_era + year_of_era / 4 - year_of_era / 100);
+            std::uint64_t shifted_month = (5 * day_of_year + 2) / 153;
+            day = static_cast<unsigned int>(day_of_year - (153 * shifted_month + 2) / 5 + 1);
+            month = static_cast<unsigned int>(shifted_month < 10 ? shifted_month + 3 : shifted_month - 9);
+            year = static_cast<std::int64_t>(year_of_era) + era * 400 + (month <= 2 ? 1 : 0);
+        }
+
+        /** Days between 0000-01-01 and 1970-01-01. */
+        constexpr std::int64_t days_to_unix_epoch = 719528;
+
+        constexpr unsigned int days_in_month(unsigned int year, unsigned int month)
+        {
+            constexpr unsigned char days[] = { 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+            bool leap = year % 4 == 0 && (year % 100 != 0 || year % 400 == 0);
+            return days[month - 1] + (month == 2 && leap ? 1 : 0);
+        }
+
+        /**
+         * Parses a date, or a date and time of day, in one of the ISO 8601 forms that `format_date_time` writes.
+         *
+         * Fields must be valid, e.g. February 30 is rejected, such that formatting reproduces the string exactly.
+         */
+        inline bool parse_date_time(const std::string_view& str, date_time& result)
+        {
+            if (str.size() < 8 || str.size() > max_date_time_size) {
+                return false;
+            }
+
+            // reads a fixed number of decimal digits
+            auto read = [&str](std::size_t& pos, std::size_t count, unsigned int& value) {
+                if (pos + count > str.size()) {
+                    return false;
+                }
+                value = 0;
+                for (std::size_t i = pos; i < pos + count; ++i) {
+                    if (str[i] < '0' || str[i] > '9') {
+                        return false;
+                    }
+                    value = 10 * value + static_cast<unsigned int>(str[i] - '0');
+                }
+                pos += count;
+                return true;
+            };
+            // skips a separator character in extended form
+            auto separator = [&str](std::size_t& pos, bool extended, char sep) {
+                if (!extended) {
+                    return true;
+                }
+                if (pos >= str.size() || str[pos] != sep) {
+                    return false;
+                }
+                ++pos;
+                return true;
+            };
+
+            std::size_t pos = 0;
+            unsigned int year, month, day;
+            if (!read(pos, 4, year)) {
+                return false;
+            }
+            bool extended = str[pos] == '-';
+            if (!separator(pos, extended, '-') || !read(pos, 2, month) || !separator(pos, extended, '-') || !read(pos, 2, day)) {
+                return false;
+            }
+            if (month < 1 || month > 12 || day < 1 || day > days_in_month(year, month)) {
+                return false;
+            }
+
+            date_time dt;
+            dt.days = static_cast<std::uint32_t>(days_from_civil(year, month, day) + days_to_unix_epoch);
+            dt.form = extended ? date_time_form::extended : 0u;
+            if (pos < str.size()) {
+                unsigned int hour, minute, second = 0;
+                if (str[pos++] != 'T' || !read(pos, 2, hour) || !separator(pos, extended, ':') || !read(pos, 2, minute)) {
+                    return false;
+                }
+                dt.form |= date_time_form::time;
+                bool has_seconds = pos < str.size() && (extended ? str[pos] == ':' : str[pos] >= '0' && str[pos] <= '9');
+                if (has_seconds) {
+                    if (!separator(pos, extended, ':') || !read(pos, 2, second)) {
+                        return false;
+                    }
+                    dt.form |= date_time_form::seconds;
+
+                    if (pos < str.size() && str[pos] == '.') {
+                        std::size_t start = ++pos;
+                        while (pos < str.size() && pos - start < max_fraction_digits && str[pos] >= '0' && str[pos] <= '9') {
+                            dt.fraction = 10 * dt.fraction + static_cast<std::uint32_t>(str[pos] - '0');
+                            ++pos;
+                        }
+                        if (pos == start) {
+                            return false;
+                        }
+                        dt.fraction_digits = static_cast<std::uint32_t>(pos - start);
+                        dt.form |= date_time_form::fraction;
+                    }
+                }
+                // a leap second is allowed only at the end of the day, where it is told apart from the next minute
+                if (hour > 23 || minute > 59 || second > (hour == 23 && minute == 59 ? 60u : 59u)) {
+                    return false;
+                }
+                dt.seconds = 3600 * hour + 60 * minute + second;
+
+                if (pos < str.size()) {
+                    char sign = str[pos++];
+                    if (sign == 'Z') {
+                        dt.form |= date_time_form::zone_utc;
+                    } else if (sign == '+' || sign == '-') {
+                        unsigned int offset_hours, offset_minutes = 0;
+                        if (!read(pos, 2, offset_hours) || offset_hours > 23) {
+                            return false;
+                        }
+                        if (pos == str.size()) {
+                            dt.form |= date_time_form::zone_hours;
+                        } else if (!separator(pos, extended, ':') || !read(pos, 2, offset_minutes) || offset_minutes > 59) {
+                            return false;
+                        } else {
+                            dt.form |= date_time_form::zone_offset;
+                        }
+                        dt.form |= sign == '-' ? date_time_form::negative : 0u;
+                        dt.offset = 60 * offset_hours + offset_minutes;
+                    } else {
+                        return false;
+                    }
+                }
+            }
+            if (pos != str.size()) {
+                return false;
+            }
+            result = dt;
+            return true;
+        }
+
+        /** Writes a date, or a date and time of day, and returns the number of characters written. */
+        inline std::size_t format_date_time(const date_time& dt, char* out)
+        {
+            char* p = out;
+            auto write = [&p](unsigned int value, std::size_t count) {
+                for (std::size_t i = count; i > 0; --i) {
+                    p[i - 1] = static_cast<char>('0' + value % 10);
+                    value /= 10;
+                }
+                p += count;
+            };
+            bool extended = (dt.form & date_time_form::extended) != 0;
+
+            std::int64_t year;
+            unsigned int month, day;
+            civil_from_days(static_cast<std::int64_t>(dt.days) - days_to_unix_epoch, year, month, day);
+            write(static_cast<unsigned int>(year), 4);
+            if (extended) {
+                *p++ = '-';
+            }
+            write(month, 2);
+            if (extended) {
+                *p++ = '-';
+            }
+            write(day, 2);
+
+            if ((dt.form & date_time_form::time) != 0) {
+                *p++ = 'T';
+                // a leap second belongs to the last minute of the day
+                bool leap = dt.seconds == 86400;
+                write(leap ? 23 : dt.seconds / 3600, 2);
+                if (extended) {
+                    *p++ = ':';
+                }
+                write(leap ? 59 : dt.seconds / 60 % 60, 2);
+                if ((dt.form & date_time_form::seconds) != 0) {
+                    if (extended) {
+                        *p++ = ':';
+                    }
+                    write(leap ? 60 : dt.seconds % 60, 2);
+                    if ((dt.form & date_time_form::fraction) != 0) {
+                        *p++ = '.';
+                        write(dt.fraction, dt.fraction_digits);
+                    }
+                }
+
+                switch (dt.form & date_time_form::zone_mask) {
+                case date_time_form::zone_utc:
+                    *p++ = 'Z';
+                    break;
+                case date_time_form::zone_offset:
+                case date_time_form::zone_hours:
+                    *p++ = (dt.form & date_time_form::negative) != 0 ? '-' : '+';
+                    write(dt.offset / 60, 2);
+                    if ((dt.form & date_time_form::zone_mask) == date_time_form::zone_offset) {
+                        if (extended) {
+                            *p++ = ':';
+                        }
+                        write(dt.offset % 60, 2);
+                    }
+                    break;
+                default:
+                    break;
+                }
+            }
+            return static_cast<std::size_t>(p - out);
+        }
+    }
+}
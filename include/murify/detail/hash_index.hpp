@@ -0,0 +1,249 @@
+/**
+ * murify: Efficient in-memory compression for URLs
+ * @see https://github.com/hunyadi/murify
+ *
+ * Copyright (c) 2024 Levente Hunyadi
+ *
+ * This work is licensed under the terms of the MIT license.
+ * For a copy, see <https://opensource.org/licenses/MIT>.
+ */
+
+#pragma once
+#include <memory>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace murify
+{
+    namespace detail
+    {
+        inline std::uint64_t rotate_left(std::uint64_t value, unsigned int shift)
+        {
+            return (value << shift) | (value >> (64 - shift));
+        }
+
+        /**
+         * Computes a 64-bit hash of a sequence of characters.
+         *
+         * The hash is identical across processes, which allows hash tables to be persisted.
+         */
+        inline std::uint64_t hash_bytes(const char* data, std::size_t size)
+        {
+            constexpr std::uint64_t c1 = 0x87c37b91114253d5ull;
+            constexpr std::uint64_t c2 = 0x4cf5ad432745937full;
+
+            std::uint64_t h = 0x9e3779b97f4a7c15ull ^ (size * c1);
+            std::uint64_t w;
+            for (; size >= 8; data += 8, size -= 8) {
+                std::memcpy(&w, data, 8);
+                h ^= rotate_left(w * c1, 31) * c2;
+                h = rotate_left(h, 27) * 5 + 0x52dce729;
+            }
+            if (size > 0) {
+                w = 0;
+                std::memcpy(&w, data, size);
+                h ^= rotate_left(w * c1, 31) * c2;
+            }
+
+            // finalization mix forces all bits of the hash to avalanche
+            h ^= h >> 33;
+            h *= 0xff51afd7ed558ccdull;
+            h ^= h >> 33;
+            h *= 0xc4ceb9fe1a85ec53ull;
+            h ^= h >> 33;
+            return h;
+        }
+
+        /**
+         * Flat open-addressing hash index that maps hash values to 32-bit ordinals.
+         *
+         * Slots are organized into groups that fill exactly one cache line: 8 control bytes followed by 7 slots. Each
+         * control byte holds either a marker for an empty slot or a 7-bit tag taken from the hash. A lookup compares
+         * the tag against all control bytes of a group at once, and only inspects slots whose tag matches. Slots store
+         * the upper 32 bits of the hash next to the ordinal, which rules out most false matches without touching the
+         * keys, and lets the index grow without re-hashing keys.
+         *
+         * Keys themselves are not stored; the caller supplies a predicate that compares a key against an ordinal.
+         * Entries cannot be removed individually.
+         */
+        struct hash_index
+        {
+            constexpr static std::size_t group_size = 7;
+
+            struct slot
+            {
+                std::uint32_t hash;
+                std::uint32_t index;
+            };
+
+            struct alignas(64) group
+            {
+                /** Control bytes of slots in the group, of which the most significant byte is unused. */
+                std::uint64_t ctrl;
+                slot slots[group_size];
+            };
+
+            hash_index() = default;
+
+            hash_index(const hash_index&) = delete;
+            hash_index& operator=(const hash_index&) = delete;
+            hash_index(hash_index&&) = default;
+            hash_index& operator=(hash_index&&) = default;
+
+            /** Number of entries in the index. */
+            std::size_t size() const
+            {
+                return _size;
+            }
+
+            /** Number of slots in the index. */
+            std::size_t capacity() const
+            {
+                return _group_count * group_size;
+            }
+
+            /**
+             * Looks up an ordinal by hash value.
+             *
+             * @param hash The hash of the key to look up.
+             * @param equals A predicate that checks whether the key matches the key associated with an ordinal.
+             * @param index Receives the ordinal associated with the key.
+             * @return True if the key is found.
+             */
+            template<typename Equals>
+            bool find(std::uint64_t hash, Equals&& equals, std::uint32_t& index) const
+            {
+                if (_group_count == 0) {
+                    return false;
+                }
+
+                std::uint32_t upper = static_cast<std::uint32_t>(hash >> 32);
+                unsigned int tag = static_cast<unsigned int>(hash & 0x7f);
+                std::size_t mask = _group_count - 1;
+                std::size_t position = upper & mask;
+                for (std::size_t step = 1; ; ++step) {
+                    const group& g = _groups[position];
+                    for (std::uint64_t bits = match(g.ctrl, tag); bits != 0; bits &= bits - 1) {
+                        const slot& s = g.slots[count_trailing_zeros(bits) / 8];
+                        if (s.hash == upper && equals(s.index)) {
+                            index = s.index;
+                            return true;
+                        }
+                    }
+                    if (match_empty(g.ctrl) != 0) {
+                        return false;
+                    }
+
+                    // triangular probing visits each group exactly once when the number of groups is a power of 2
+                    position = (position + step) & mask;
+                }
+            }
+
+            /**
+             * Associates an ordinal with a hash value.
+             *
+             * The caller must make sure the key is not already in the index.
+             */
+            void insert(std::uint64_t hash, std::uint32_t index)
+            {
+                // keep load factor at most 7/8
+                if (8 * (_size + 1) > 7 * capacity()) {
+                    grow();
+                }
+                place(static_cast<std::uint32_t>(hash >> 32), static_cast<unsigned int>(hash & 0x7f), index);
+                ++_size;
+            }
+
+            /** Removes all entries, and releases memory. */
+            void clear()
+            {
+                _groups.reset();
+                _group_count = 0;
+                _size = 0;
+            }
+
+        private:
+            constexpr static std::uint64_t lsb = 0x0001010101010101ull;
+            constexpr static std::uint64_t msb = 0x0080808080808080ull;
+
+            /** Control bytes of a group with all slots empty. */
+            constexpr static std::uint64_t empty = 0x0080808080808080ull;
+
+            static unsigned int count_trailing_zeros(std::uint64_t bits)
+            {
+#if defined(__GNUC__)
+                return static_cast<unsigned int>(__builtin_ctzll(bits));
+#else
+                unsigned int n = 0;
+                for (; (bits & 1) == 0; bits >>= 1) {
+                    ++n;
+                }
+                return n;
+#endif
+            }
+
+            /**
+             * Sets the most significant bit in each control byte that may equal the tag.
+             *
+             * A byte that follows a matching byte may be reported as a false match, which is filtered out by comparing
+             * the hash stored in the slot.
+             */
+            static std::uint64_t match(std::uint64_t ctrl, unsigned int tag)
+            {
+                std::uint64_t x = ctrl ^ (lsb * tag);
+                return (x - lsb) & ~x & msb;
+            }
+
+            /** Sets the most significant bit in each control byte that marks an empty slot. */
+            static std::uint64_t match_empty(std::uint64_t ctrl)
+            {
+                return ctrl & msb;
+            }
+
+            void place(std::uint32_t upper, unsigned int tag, std::uint32_t index)
+            {
+                std::size_t mask = _group_count - 1;
+                std::size_t position = upper & mask;
+                for (std::size_t step = 1; ; ++step) {
+                    group& g = _groups[position];
+                    std::uint64_t bits = match_empty(g.ctrl);
+                    if (bits != 0) {
+                        unsigned int k = count_trailing_zeros(bits) / 8;
+                        g.ctrl ^= static_cast<std::uint64_t>(0x80 | tag) << (8 * k);
+                        g.slots[k] = slot{ upper, index };
+                        return;
+                    }
+                    position = (position + step) & mask;
+                }
+            }
+
+            void grow()
+            {
+                std::size_t group_count = _group_count == 0 ? 1 : 2 * _group_count;
+                std::unique_ptr<group[]> groups = std::move(_groups);
+                std::size_t old_group_count = _group_count;
+
+                _groups.reset(new group[group_count]);
+                _group_count = group_count;
+                for (std::size_t k = 0; k < group_count; ++k) {
+                    _groups[k].ctrl = empty;
+                }
+
+                for (std::size_t k = 0; k < old_group_count; ++k) {
+                    const group& g = groups[k];
+                    for (unsigned int i = 0; i < group_size; ++i) {
+                        unsigned int tag = static_cast<unsigned int>(g.ctrl >> (8 * i)) & 0xff;
+                        if ((tag & 0x80) == 0) {
+                            place(g.slots[i].hash, tag, g.slots[i].index);
+                        }
+                    }
+                }
+            }
+
+            std::unique_ptr<group[]> _groups;
+            std::size_t _group_count = 0;
+            std::size_t _size = 0;
+        };
+    }
+}
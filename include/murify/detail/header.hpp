@@ -39,8 +39,27 @@ namespace murify
 
         enum class Encapsulation : unsigned int
         {
+            /** UUID with lowercase hexadecimal digits. */
             uuid = 0,
-            jwt = 1
+            jwt = 1,
+            /** UUID with uppercase hexadecimal digits. */
+            uuid_upper = 2,
+            /** Integer with leading zeros, followed by the number of leading zeros and the value as integers. */
+            zero_padded = 3,
+            /** String of decimal digits too long for an integer, followed by the number of digits and limbs of digits. */
+            decimal = 4,
+            /** String with percent-escapes, followed by positions that deviate from canonical escaping and the decoded string. */
+            percent_encoded = 5,
+            /** IPv4 address in dotted-decimal notation, followed by 4 bytes. */
+            ipv4 = 6,
+            /** IPv6 address, followed by a byte of textual form flags, 16 bytes and an optional zone ID. */
+            ipv6 = 7,
+            /** ISO 8601 date and time, followed by a byte of textual form flags and packed date and time fields. */
+            date_time = 8,
+            /** Signed decimal number, followed by textual form and scale combined as an integer, the mantissa and the exponent. */
+            number = 9,
+            /** Token in the built-in dictionary, followed by its index in a byte. */
+            builtin = 10
         };
 
         struct embedded_value_t
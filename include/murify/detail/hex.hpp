@@ -0,0 +1,67 @@
+/**
+ * murify: Efficient in-memory compression for URLs
+ * @see https://github.com/hunyadi/murify
+ *
+ * Copyright (c) 2024 Levente Hunyadi
+ *
+ * This work is licensed under the terms of the MIT license.
+ * For a copy, see <https://opensource.org/licenses/MIT>.
+ */
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+namespace murify
+{
+    namespace detail
+    {
+        /**
+         * Value of a hexadecimal digit `0-9`, `a-f` or `A-F`, without branching.
+         *
+         * The low nibble of a digit character is its value, and the low nibble of a letter is its value minus 9. Letters
+         * are told apart from digits by bit 6 of the character code.
+         */
+        constexpr unsigned int hex_value(char c)
+        {
+            unsigned int u = static_cast<unsigned char>(c);
+            return (u & 0x0f) + 9 * (u >> 6);
+        }
+
+        /**
+         * Hexadecimal digit character of a value in the range 0 to 15, without branching.
+         *
+         * @param upper True for uppercase letters `A-F`, false for lowercase letters `a-f`.
+         */
+        constexpr char hex_digit(unsigned int value, bool upper)
+        {
+            // all bits are set in the mask if the value is greater than 9
+            unsigned int mask = static_cast<unsigned int>(static_cast<int>(9 - value) >> 8);
+            unsigned int offset = upper ? 'A' - '0' - 10 : 'a' - '0' - 10;
+            return static_cast<char>('0' + value + (mask & offset));
+        }
+
+        /**
+         * Decodes pairs of hexadecimal digits into bytes, the first digit of each pair being the high nibble.
+         *
+         * @param input Characters that must all be hexadecimal digits.
+         * @param count Number of bytes to produce, reading twice as many characters.
+         */
+        inline void hex_decode(const char* input, std::size_t count, std::byte* output)
+        {
+            for (std::size_t i = 0; i < count; ++i) {
+                output[i] = static_cast<std::byte>((hex_value(input[2 * i]) << 4) | hex_value(input[2 * i + 1]));
+            }
+        }
+
+        /** Encodes bytes as pairs of hexadecimal digits, writing twice as many characters as there are bytes. */
+        inline void hex_encode(const std::byte* input, std::size_t count, char* output, bool upper)
+        {
+            for (std::size_t i = 0; i < count; ++i) {
+                unsigned int value = static_cast<unsigned int>(input[i]);
+                output[2 * i] = hex_digit(value >> 4, upper);
+                output[2 * i + 1] = hex_digit(value & 0x0f, upper);
+            }
+        }
+    }
+}
@@ -52,6 +52,35 @@ namespace murify
             }
         }
 
+        /** Number of decimal digits in a limb of a long decimal number, the most that always fits 64 bits. */
+        constexpr std::size_t decimal_limb_digits = 19;
+
+        /** Number of bytes that hold any decimal number of the given number of digits, at most `decimal_limb_digits`. */
+        inline unsigned int get_decimal_width(std::size_t digits)
+        {
+            constexpr unsigned char widths[] = { 0, 1, 1, 2, 2, 3, 3, 3, 4, 4, 5, 5, 5, 6, 6, 7, 7, 8, 8, 8 };
+            return widths[digits];
+        }
+
+        /** Value of a string of decimal digits that fits 64 bits. */
+        inline std::uint64_t parse_decimal(const char* digits, std::size_t count)
+        {
+            std::uint64_t value = 0;
+            for (std::size_t i = 0; i < count; ++i) {
+                value = 10 * value + static_cast<unsigned int>(digits[i] - '0');
+            }
+            return value;
+        }
+
+        /** Writes a value as exactly the given number of decimal digits, with leading zeros if necessary. */
+        inline void format_decimal(std::uint64_t value, char* digits, std::size_t count)
+        {
+            for (std::size_t i = count; i > 0; --i) {
+                digits[i - 1] = static_cast<char>('0' + value % 10);
+                value /= 10;
+            }
+        }
+
         inline unsigned long long read_integer(const std::basic_string_view<std::byte>& data)
         {
             using ull = unsigned long long;
@@ -112,24 +141,32 @@ namespace murify
             }
         }
 
-        inline void write_integer(std::basic_string<std::byte>& data, unsigned int width, std::uint64_t value)
+        template<typename Output>
+        inline void write_integer(Output& data, unsigned int width, std::uint64_t value)
         {
             switch (width)
             {
             case 8:
                 data.push_back(static_cast<std::byte>((value >> 56) & 0xff));
+                [[fallthrough]];
             case 7:
                 data.push_back(static_cast<std::byte>((value >> 48) & 0xff));
+                [[fallthrough]];
             case 6:
                 data.push_back(static_cast<std::byte>((value >> 40) & 0xff));
+                [[fallthrough]];
             case 5:
                 data.push_back(static_cast<std::byte>((value >> 32) & 0xff));
+                [[fallthrough]];
             case 4:
                 data.push_back(static_cast<std::byte>((value >> 24) & 0xff));
+                [[fallthrough]];
             case 3:
                 data.push_back(static_cast<std::byte>((value >> 16) & 0xff));
+                [[fallthrough]];
             case 2:
                 data.push_back(static_cast<std::byte>((value >> 8) & 0xff));
+                [[fallthrough]];
             case 1:
                 data.push_back(static_cast<std::byte>(value & 0xff));
             default:
@@ -137,16 +174,20 @@ namespace murify
             }
         }
 
-        inline void write_integer(std::basic_string<std::byte>& data, unsigned int width, std::uint32_t value)
+        template<typename Output>
+        inline void write_integer(Output& data, unsigned int width, std::uint32_t value)
         {
             switch (width)
             {
             case 4:
                 data.push_back(static_cast<std::byte>((value >> 24) & 0xff));
+                [[fallthrough]];
             case 3:
                 data.push_back(static_cast<std::byte>((value >> 16) & 0xff));
+                [[fallthrough]];
             case 2:
                 data.push_back(static_cast<std::byte>((value >> 8) & 0xff));
+                [[fallthrough]];
             case 1:
                 data.push_back(static_cast<std::byte>(value & 0xff));
             default:
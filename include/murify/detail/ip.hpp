@@ -0,0 +1,254 @@
+/**
+ * murify: Efficient in-memory compression for URLs
+ * @see https://github.com/hunyadi/murify
+ *
+ * Copyright (c) 2024 Levente Hunyadi
+ *
+ * This work is licensed under the terms of the MIT license.
+ * For a copy, see <https://opensource.org/licenses/MIT>.
+ */
+
+#pragma once
+#include "hex.hpp"
+#include "percent.hpp"
+
+#include <string_view>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+
+namespace murify
+{
+    namespace detail
+    {
+        /** Longest textual form of an IPv4 address, e.g. `255.255.255.255`. */
+        constexpr std::size_t max_ipv4_size = 15;
+
+        /** Longest textual form of an IPv6 address, e.g. `ffff:ffff:ffff:ffff:ffff:ffff:255.255.255.255`. */
+        constexpr std::size_t max_ipv6_size = 45;
+
+        /**
+         * Parses an IPv4 address in dotted-decimal notation.
+         *
+         * Only the canonical form is accepted, i.e. four decimal octets without leading zeros, such that formatting
+         * the address reproduces the string exactly.
+         */
+        inline bool parse_ipv4(const std::string_view& str, std::byte* out)
+        {
+            if (str.size() < 7 || str.size() > max_ipv4_size) {
+                return false;
+            }
+            std::size_t i = 0;
+            for (std::size_t k = 0; k < 4; ++k) {
+                if (k > 0) {
+                    if (i >= str.size() || str[i] != '.') {
+                        return false;
+                    }
+                    ++i;
+                }
+                std::size_t start = i;
+                unsigned int value = 0;
+                while (i < str.size() && i - start < 3 && str[i] >= '0' && str[i] <= '9') {
+                    value = 10 * value + static_cast<unsigned int>(str[i] - '0');
+                    ++i;
+                }
+                if (i == start || value > 255 || (str[start] == '0' && i - start > 1)) {
+                    return false;
+                }
+                out[k] = static_cast<std::byte>(value);
+            }
+            return i == str.size();
+        }
+
+        /** Writes an IPv4 address in dotted-decimal notation, and returns the number of characters written. */
+        inline std::size_t format_ipv4(const std::byte* address, char* out)
+        {
+            char* p = out;
+            for (std::size_t k = 0; k < 4; ++k) {
+                if (k > 0) {
+                    *p++ = '.';
+                }
+                unsigned int value = static_cast<unsigned int>(address[k]);
+                if (value >= 100) {
+                    *p++ = static_cast<char>('0' + value / 100);
+                }
+                if (value >= 10) {
+                    *p++ = static_cast<char>('0' + value / 10 % 10);
+                }
+                *p++ = static_cast<char>('0' + value % 10);
+            }
+            return static_cast<std::size_t>(p - out);
+        }
+
+        /**
+         * Variations in the textual form of an IPv6 address, which make formatting reproduce a string exactly.
+         *
+         * The default form is the recommended one in RFC 5952: lowercase hexadecimal digits, no leading zeros in
+         * groups, and the longest run of two or more zero groups (the first, if there is a tie) replaced with `::`.
+         */
+        namespace ipv6_form
+        {
+            /** Hexadecimal digits are uppercase. */
+            constexpr unsigned int upper = 1u << 0;
+            /** The last 32 bits are written as an IPv4 address in dotted-decimal notation. */
+            constexpr unsigned int ipv4_suffix = 1u << 1;
+            /** All groups are written with four digits, and zero groups are not replaced with `::`. */
+            constexpr unsigned int expanded = 1u << 2;
+            /** All of the above. */
+            constexpr unsigned int all = upper | ipv4_suffix | expanded;
+        }
+
+        /** Writes an IPv6 address in the given textual form, and returns the number of characters written. */
+        inline std::size_t format_ipv6(const std::byte* address, unsigned int form, char* out)
+        {
+            bool upper = (form & ipv6_form::upper) != 0;
+            std::size_t groups = (form & ipv6_form::ipv4_suffix) != 0 ? 6 : 8;
+
+            // longest run of zero groups
+            std::size_t run_start = groups;
+            std::size_t run_length = 0;
+            if ((form & ipv6_form::expanded) == 0) {
+                for (std::size_t k = 0; k < groups;) {
+                    std::size_t n = 0;
+                    while (k + n < groups && address[2 * (k + n)] == std::byte{ 0 } && address[2 * (k + n) + 1] == std::byte{ 0 }) {
+                        ++n;
+                    }
+                    if (n >= 2 && n > run_length) {
+                        run_start = k;
+                        run_length = n;
+                    }
+                    k += n > 0 ? n : 1;
+                }
+            }
+
+            char* p = out;
+            for (std::size_t k = 0; k < groups; ++k) {
+                if (k == run_start) {
+                    *p++ = ':';
+                    *p++ = ':';
+                    k += run_length - 1;
+                    continue;
+                }
+                if (k > 0 && k != run_start + run_length) {
+                    *p++ = ':';
+                }
+                unsigned int value = (static_cast<unsigned int>(address[2 * k]) << 8) | static_cast<unsigned int>(address[2 * k + 1]);
+                bool significant = (form & ipv6_form::expanded) != 0;
+                for (int shift = 12; shift >= 0; shift -= 4) {
+                    unsigned int nibble = (value >> shift) & 0x0f;
+                    significant = significant || nibble != 0 || shift == 0;
+                    if (significant) {
+                        *p++ = hex_digit(nibble, upper);
+                    }
+                }
+            }
+            if ((form & ipv6_form::ipv4_suffix) != 0) {
+                if (run_start + run_length != groups) {
+                    *p++ = ':';
+                }
+                p += format_ipv4(address + 12, p);
+            }
+            return static_cast<std::size_t>(p - out);
+        }
+
+        /**
+         * Parses an IPv6 address, and determines the textual form that reproduces the string exactly.
+         *
+         * @param out Receives the 16 bytes of the address.
+         * @param form Receives a combination of `ipv6_form` flags.
+         * @return False if the string is not an IPv6 address, or is not in any form that `format_ipv6` writes.
+         */
+        inline bool parse_ipv6(const std::string_view& str, std::byte* out, unsigned int& form)
+        {
+            if (str.size() < 2 || str.size() > max_ipv6_size) {
+                return false;
+            }
+
+            std::uint16_t groups[8] = {};
+            std::size_t count = 0;
+            std::size_t gap = 8;
+            bool has_ipv4 = false;
+            bool has_lower = false;
+            bool has_upper = false;
+            std::size_t i = 0;
+            if (str[0] == ':') {
+                if (str[1] != ':') {
+                    return false;
+                }
+                gap = 0;
+                i = 2;
+            }
+            while (i < str.size()) {
+                std::size_t end = std::min(str.find(':', i), str.size());
+                std::string_view token = str.substr(i, end - i);
+                if (token.find('.') != std::string_view::npos) {
+                    // embedded IPv4 address, only as the last 32 bits
+                    std::byte ipv4[4];
+                    if (end != str.size() || count > 6 || !parse_ipv4(token, ipv4)) {
+                        return false;
+                    }
+                    groups[count++] = static_cast<std::uint16_t>((static_cast<unsigned int>(ipv4[0]) << 8) | static_cast<unsigned int>(ipv4[1]));
+                    groups[count++] = static_cast<std::uint16_t>((static_cast<unsigned int>(ipv4[2]) << 8) | static_cast<unsigned int>(ipv4[3]));
+                    has_ipv4 = true;
+                    i = end;
+                    break;
+                }
+                if (token.empty() || token.size() > 4 || count == 8) {
+                    return false;
+                }
+                unsigned int value = 0;
+                for (char c : token) {
+                    if (!is_hex_digit(c)) {
+                        return false;
+                    }
+                    has_lower = has_lower || (c >= 'a' && c <= 'f');
+                    has_upper = has_upper || (c >= 'A' && c <= 'F');
+                    value = (value << 4) | hex_value(c);
+                }
+                groups[count++] = static_cast<std::uint16_t>(value);
+                i = end;
+                if (i == str.size()) {
+                    break;
+                }
+
+                // skip the separator, and note the position of `::`
+                ++i;
+                if (i < str.size() && str[i] == ':') {
+                    if (gap != 8) {
+                        return false;
+                    }
+                    gap = count;
+                    ++i;
+                } else if (i == str.size()) {
+                    return false;
+                }
+            }
+            if (has_lower && has_upper) {
+                return false;
+            }
+            if (gap == 8 ? count != 8 : count >= 8) {
+                return false;
+            }
+
+            // zero groups replaced with `::` go in between the groups before and after it
+            std::size_t shift = 8 - count;
+            for (std::size_t k = 8; k-- > 0;) {
+                std::uint16_t value = k < gap ? groups[k] : (k >= gap + shift ? groups[k - shift] : 0);
+                out[2 * k] = static_cast<std::byte>(value >> 8);
+                out[2 * k + 1] = static_cast<std::byte>(value & 0xff);
+            }
+
+            // the string is accepted only if it is reproduced exactly in one of the forms
+            char text[max_ipv6_size];
+            unsigned int base = (has_upper ? ipv6_form::upper : 0u) | (has_ipv4 ? ipv6_form::ipv4_suffix : 0u);
+            for (unsigned int f : { base, base | ipv6_form::expanded }) {
+                std::size_t size = format_ipv6(out, f, text);
+                if (std::string_view(text, size) == str) {
+                    form = f;
+                    return true;
+                }
+            }
+            return false;
+        }
+    }
+}
@@ -0,0 +1,153 @@
+/**
+ * murify: Efficient in-memory compression for URLs
+ * @see https://github.com/hunyadi/murify
+ *
+ * Copyright (c) 2024 Levente Hunyadi
+ *
+ * This work is licensed under the terms of the MIT license.
+ * For a copy, see <https://opensource.org/licenses/MIT>.
+ */
+
+#pragma once
+#include <string_view>
+#include <cstddef>
+#include <cstdint>
+
+namespace murify
+{
+    namespace detail
+    {
+        /** Most significant digits in a decimal number, which fit into a 64-bit integer. */
+        constexpr std::size_t max_number_digits = 19;
+
+        /** Longest textual form of a decimal number, with sign, decimal point, exponent marker and exponent sign. */
+        constexpr std::size_t max_number_size = 1 + max_number_digits + 2 + 2 + max_number_digits;
+
+        /**
+         * A signed decimal number in positional or scientific notation, with its textual form.
+         *
+         * The value is `mantissa * 10^-scale`, times `10^exponent` in scientific notation. Signs and the exponent
+         * marker are each one of three choices, combined into `form` as digits in base 3.
+         */
+        struct decimal_number
+        {
+            /** Significant digits, including trailing zeros of the fractional part. */
+            std::uint64_t mantissa = 0;
+            /** Number of digits after the decimal point. */
+            std::uint32_t scale = 0;
+            /** Absolute value of the exponent in scientific notation. */
+            std::uint64_t exponent = 0;
+            /** Sign (none, `-` or `+`), plus 3 times exponent marker (none, `e` or `E`), plus 9 times exponent sign. */
+            unsigned int form = 0;
+        };
+
+        /** Number of distinct values of `decimal_number::form`. */
+        constexpr unsigned int number_form_count = 27;
+
+        /**
+         * Parses a signed decimal number, e.g. `-122.4194` or `1e-3`.
+         *
+         * The integer part is either `0` or has no leading zeros, and so does the exponent, such that formatting
+         * reproduces the string exactly. Trailing zeros of the fractional part are kept.
+         */
+        inline bool parse_number(const std::string_view& str, decimal_number& result)
+        {
+            if (str.empty() || str.size() > max_number_size) {
+                return false;
+            }
+
+            // index of a character among three choices, the first of which is no character
+            auto choice = [&str](std::size_t& pos, char first, char second) {
+                unsigned int c = 0;
+                if (pos < str.size() && (str[pos] == first || str[pos] == second)) {
+                    c = str[pos++] == first ? 1 : 2;
+                }
+                return c;
+            };
+            // digits without leading zeros, appended to a value
+            auto digits = [&str](std::size_t& pos, std::uint64_t& value, std::size_t& count) {
+                std::size_t start = pos;
+                while (pos < str.size() && str[pos] >= '0' && str[pos] <= '9' && pos - start < max_number_digits) {
+                    value = 10 * value + static_cast<std::uint64_t>(str[pos] - '0');
+                    ++pos;
+                }
+                count = pos - start;
+                return count > 0 && !(count > 1 && str[start] == '0');
+            };
+
+            decimal_number n;
+            std::size_t pos = 0;
+            unsigned int sign = choice(pos, '-', '+');
+            std::size_t integer_digits;
+            if (!digits(pos, n.mantissa, integer_digits)) {
+                return false;
+            }
+            if (pos < str.size() && str[pos] == '.') {
+                std::size_t start = ++pos;
+                while (pos < str.size() && str[pos] >= '0' && str[pos] <= '9' && integer_digits + (pos - start) < max_number_digits) {
+                    n.mantissa = 10 * n.mantissa + static_cast<std::uint64_t>(str[pos] - '0');
+                    ++pos;
+                }
+                if (pos == start) {
+                    return false;
+                }
+                n.scale = static_cast<std::uint32_t>(pos - start);
+            }
+            unsigned int marker = choice(pos, 'e', 'E');
+            unsigned int exponent_sign = 0;
+            if (marker != 0) {
+                exponent_sign = choice(pos, '-', '+');
+                std::size_t exponent_digits;
+                if (!digits(pos, n.exponent, exponent_digits)) {
+                    return false;
+                }
+            }
+            if (pos != str.size()) {
+                return false;
+            }
+            n.form = sign + 3 * marker + 9 * exponent_sign;
+            result = n;
+            return true;
+        }
+
+        /** Writes a signed decimal number, and returns the number of characters written. */
+        inline std::size_t format_number(const decimal_number& n, char* out)
+        {
+            constexpr char signs[] = { 0, '-', '+' };
+            constexpr char markers[] = { 0, 'e', 'E' };
+
+            char* p = out;
+            if (n.form % 3 != 0) {
+                *p++ = signs[n.form % 3];
+            }
+
+            // significant digits, with at least one digit in front of the decimal point
+            char digits[max_number_digits + 1];
+            std::size_t count = 0;
+            for (std::uint64_t value = n.mantissa; value != 0 || count <= n.scale; value /= 10) {
+                digits[count++] = static_cast<char>('0' + value % 10);
+            }
+            for (std::size_t k = count; k > 0; --k) {
+                if (k == n.scale) {
+                    *p++ = '.';
+                }
+                *p++ = digits[k - 1];
+            }
+
+            if (n.form / 3 % 3 != 0) {
+                *p++ = markers[n.form / 3 % 3];
+                if (n.form / 9 != 0) {
+                    *p++ = signs[n.form / 9];
+                }
+                count = 0;
+                for (std::uint64_t value = n.exponent; value != 0 || count == 0; value /= 10) {
+                    digits[count++] = static_cast<char>('0' + value % 10);
+                }
+                for (std::size_t k = count; k > 0; --k) {
+                    *p++ = digits[k - 1];
+                }
+            }
+            return static_cast<std::size_t>(p - out);
+        }
+    }
+}
@@ -0,0 +1,78 @@
+/**
+ * murify: Efficient in-memory compression for URLs
+ * @see https://github.com/hunyadi/murify
+ *
+ * Copyright (c) 2024 Levente Hunyadi
+ *
+ * This work is licensed under the terms of the MIT license.
+ * For a copy, see <https://opensource.org/licenses/MIT>.
+ */
+
+#pragma once
+#include "char_set.hpp"
+#include "hex.hpp"
+
+#include <string_view>
+#include <cstddef>
+
+namespace murify
+{
+    namespace detail
+    {
+        /** Characters that are never percent-encoded in canonical form, i.e. unreserved characters in RFC 3986. */
+        constexpr char_set percent_unreserved("ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-._~");
+
+        inline bool is_hex_digit(char c)
+        {
+            return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F');
+        }
+
+        /**
+         * Decodes percent-escapes in a string.
+         *
+         * In canonical form, exactly the characters that are not unreserved are percent-encoded. A character in the
+         * decoded string that is percent-encoded but unreserved, or not percent-encoded but not unreserved, deviates
+         * from canonical form.
+         *
+         * @param out Receives the decoded string, which takes at most as many characters as the input, or null if only
+         * the size of the decoded string and deviations are sought.
+         * @param size Receives the number of characters in the decoded string.
+         * @param upper Set to true if escapes use uppercase hexadecimal digits.
+         * @param deviation Invoked with the position of each character in the decoded string that deviates from
+         * canonical form, in increasing order.
+         * @return False if an escape is malformed, or escapes mix lowercase and uppercase hexadecimal digits.
+         */
+        template<typename Fn>
+        bool percent_decode(const std::string_view& in, char* out, std::size_t& size, bool& upper, Fn&& deviation)
+        {
+            bool has_lower = false;
+            bool has_upper = false;
+            size = 0;
+            for (std::size_t i = 0; i < in.size(); ++i) {
+                char c = in[i];
+                if (c == '%') {
+                    if (i + 2 >= in.size() || !is_hex_digit(in[i + 1]) || !is_hex_digit(in[i + 2])) {
+                        return false;
+                    }
+                    for (char h : { in[i + 1], in[i + 2] }) {
+                        has_lower = has_lower || (h >= 'a' && h <= 'f');
+                        has_upper = has_upper || (h >= 'A' && h <= 'F');
+                    }
+                    c = static_cast<char>((hex_value(in[i + 1]) << 4) | hex_value(in[i + 2]));
+                    if (percent_unreserved.contains(c)) {
+                        deviation(size);
+                    }
+                    i += 2;
+                } else if (!percent_unreserved.contains(c)) {
+                    deviation(size);
+                }
+                if (out != nullptr) {
+                    out[size] = c;
+                }
+                ++size;
+            }
+            upper = has_upper;
+            return !(has_lower && has_upper);
+        }
+    }
+}
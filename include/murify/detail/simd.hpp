@@ -0,0 +1,85 @@
+/**
+ * murify: Efficient in-memory compression for URLs
+ * @see https://github.com/hunyadi/murify
+ *
+ * Copyright (c) 2024 Levente Hunyadi
+ *
+ * This work is licensed under the terms of the MIT license.
+ * For a copy, see <https://opensource.org/licenses/MIT>.
+ */
+
+#pragma once
+
+/**
+ * Vectorized kernels are compiled for x86 with GCC, Clang and MSVC.
+ *
+ * With GCC and Clang, each kernel is compiled for its own instruction set with a target attribute, and the widest
+ * kernel the processor supports is selected at run time. When the build targets AVX2 (e.g. with `-mavx2`, see the
+ * CMake option `MURIFY_USE_AVX2`), the AVX2 kernels are selected without a run-time check. MSVC compiles intrinsics
+ * for any instruction set without an attribute.
+ */
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define MURIFY_SIMD_X86 1
+#define MURIFY_TARGET_AVX2 __attribute__((target("avx2")))
+#define MURIFY_TARGET_SSE41 __attribute__((target("sse4.1")))
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#define MURIFY_SIMD_X86 1
+#define MURIFY_TARGET_AVX2
+#define MURIFY_TARGET_SSE41
+#endif
+
+#if defined(MURIFY_SIMD_X86)
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+namespace murify
+{
+    namespace detail
+    {
+        /** Instruction set extensions vectorized kernels may use, in order of increasing width. */
+        enum class simd_level
+        {
+            scalar,
+            sse41,
+            avx2
+        };
+
+        inline simd_level detect_simd_level()
+        {
+#if defined(__AVX2__)
+            return simd_level::avx2;
+#elif defined(MURIFY_SIMD_X86) && defined(__GNUC__)
+            __builtin_cpu_init();
+            if (__builtin_cpu_supports("avx2")) {
+                return simd_level::avx2;
+            }
+            if (__builtin_cpu_supports("sse4.1")) {
+                return simd_level::sse41;
+            }
+            return simd_level::scalar;
+#elif defined(MURIFY_SIMD_X86) && defined(_MSC_VER)
+            // AVX2 requires operating system support for saving extended registers, which is assumed only when the
+            // build targets AVX2
+            int info[4];
+            __cpuid(info, 1);
+            return (info[2] & (1 << 19)) != 0 ? simd_level::sse41 : simd_level::scalar;
+#else
+            return simd_level::scalar;
+#endif
+        }
+
+        /** The widest instruction set extension the processor supports, detected once. */
+        inline simd_level simd_support()
+        {
+#if defined(__AVX2__)
+            return simd_level::avx2;
+#else
+            static const simd_level level = detect_simd_level();
+            return level;
+#endif
+        }
+    }
+}
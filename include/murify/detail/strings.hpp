@@ -9,6 +9,8 @@
  */
 
 #pragma once
+#include "char_set.hpp"
+
 #include <string>
 #include <string_view>
 #include <vector>
@@ -47,16 +49,77 @@ namespace murify
         inline std::vector<std::string_view> split(const std::string_view& in, char sep)
         {
             std::vector<std::string_view> r;
-            for (std::size_t p = 0; ; ++p) {
-                std::size_t q = p;
-                p = in.find(sep, q);
+            std::size_t q = 0;
+            char_set(sep).for_each_in(in, [&](std::size_t p) {
                 r.push_back(in.substr(q, p - q));
-                if (p == std::string_view::npos) {
-                    return r;
+                q = p + 1;
+            });
+            r.push_back(in.substr(q));
+            return r;
+        }
+
+        /**
+         * Counts the parts a string would be split into along occurrences of the separator character.
+         *
+         * @param in The string to split.
+         * @param sep The character that is separating the parts.
+         */
+        inline std::size_t count_parts(const std::string_view& in, char sep)
+        {
+            return char_set(sep).count_in(in) + 1;
+        }
+
+        /**
+         * Invokes a function on each part of a string split along occurrences of the separator character.
+         *
+         * Visits the same parts as `split` but without allocating storage for them.
+         *
+         * @param in The string to split.
+         * @param sep The character that is separating the parts.
+         * @param fn The function to invoke with each part.
+         */
+        template<typename Fn>
+        inline void for_each_part(const std::string_view& in, char sep, Fn&& fn)
+        {
+            std::size_t q = 0;
+            char_set(sep).for_each_in(in, [&](std::size_t p) {
+                fn(in.substr(q, p - q));
+                q = p + 1;
+            });
+            fn(in.substr(q));
+        }
+
+        /**
+         * Invokes a function on each part of a string, including the separator characters.
+         *
+         * Visits the same parts as `tokenize` but without allocating storage for them.
+         *
+         * @param in The string to split.
+         * @param chars The set of separator characters, which are passed to the function as parts of their own.
+         * @param fn The function to invoke with each part.
+         */
+        template<typename Fn>
+        inline void for_each_token(const std::string_view& in, const char_set& chars, Fn&& fn)
+        {
+            std::size_t q = 0;
+            chars.for_each_in(in, [&](std::size_t p) {
+                if (p > q) {
+                    fn(in.substr(q, p - q));
                 }
+                fn(in.substr(p, 1));
+                q = p + 1;
+            });
+            if (q < in.size()) {
+                fn(in.substr(q));
             }
         }
 
+        template<typename Fn>
+        inline void for_each_token(const std::string_view& in, const char* chars, Fn&& fn)
+        {
+            for_each_token(in, char_set(chars), fn);
+        }
+
         /**
          * Splits a string into parts, including the separator characters.
          *
@@ -66,18 +129,26 @@ namespace murify
         inline std::vector<std::string_view> tokenize(const std::string_view& in, const char* chars)
         {
             std::vector<std::string_view> r;
-            for (std::size_t p = 0; ; ++p) {
-                std::size_t q = p;
-                p = in.find_first_of(chars, q);
-                auto piece = in.substr(q, p - q);
-                if (!piece.empty()) {
-                    r.push_back(piece);
-                }
-                if (p == std::string_view::npos) {
-                    return r;
-                }
-                r.push_back(in.substr(p, 1));
-            }
+            for_each_token(in, char_set(chars), [&r](const std::string_view& piece) { r.push_back(piece); });
+            return r;
+        }
+
+        /**
+         * Counts the parts `tokenize` would produce, including the separator characters.
+         *
+         * @param in The string to split.
+         * @param chars The set of separator characters.
+         */
+        inline std::size_t count_tokens(const std::string_view& in, const char_set& chars)
+        {
+            std::size_t count = 0;
+            for_each_token(in, chars, [&count](const std::string_view&) { ++count; });
+            return count;
+        }
+
+        inline std::size_t count_tokens(const std::string_view& in, const char* chars)
+        {
+            return count_tokens(in, char_set(chars));
         }
 
         /**
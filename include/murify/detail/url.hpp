@@ -0,0 +1,188 @@
+/**
+ * murify: Efficient in-memory compression for URLs
+ * @see https://github.com/hunyadi/murify
+ *
+ * Copyright (c) 2024 Levente Hunyadi
+ *
+ * This work is licensed under the terms of the MIT license.
+ * For a copy, see <https://opensource.org/licenses/MIT>.
+ */
+
+#pragma once
+#include "char_set.hpp"
+
+#include <string_view>
+#include <algorithm>
+#include <cstddef>
+
+namespace murify
+{
+    namespace detail
+    {
+        /**
+         * Components of a URI reference.
+         *
+         * A component that is absent is distinguished from a component that is present but empty, such that joining
+         * the components with their delimiters reproduces the original string exactly.
+         */
+        struct url_components
+        {
+            std::string_view scheme;
+            std::string_view userinfo;
+            std::string_view host;
+            std::string_view port;
+            std::string_view path;
+            std::string_view query;
+            std::string_view fragment;
+
+            bool has_scheme = false;
+            bool has_authority = false;
+            bool has_userinfo = false;
+            bool has_port = false;
+            bool has_query = false;
+            bool has_fragment = false;
+        };
+
+        /**
+         * Splits a URI reference into components, as with the regular expression in appendix B of RFC 3986:
+         *
+         * ```
+         * ^(([^:/?#]+):)?(//([^/?#]*))?([^?#]*)(\?([^#]*))?(#(.*))?
+         * ```
+         *
+         * The authority is further split into user information (before the last `@`), host and port (after the last
+         * `:` that follows the host, if it consists of decimal digits). An IPv6 host is enclosed in brackets. Any
+         * string is split successfully, albeit not necessarily into meaningful components.
+         */
+        inline url_components parse_url(std::string_view str)
+        {
+            constexpr char_set scheme_end(":/?#");
+            constexpr char_set authority_end("/?#");
+            constexpr char_set path_end("?#");
+
+            // position of the first character in the set, or the length of the string
+            auto find = [&str](const char_set& set, std::size_t from) {
+                std::size_t pos = from;
+                while (pos < str.size() && !set.contains(str[pos])) {
+                    ++pos;
+                }
+                return pos;
+            };
+
+            url_components c;
+
+            std::size_t pos = find(scheme_end, 0);
+            if (pos < str.size() && pos > 0 && str[pos] == ':') {
+                c.has_scheme = true;
+                c.scheme = str.substr(0, pos);
+                str.remove_prefix(pos + 1);
+            }
+
+            if (str.size() >= 2 && str[0] == '/' && str[1] == '/') {
+                c.has_authority = true;
+                std::size_t end = find(authority_end, 2);
+                std::string_view authority = str.substr(2, end - 2);
+                str.remove_prefix(end);
+
+                std::size_t at = authority.rfind('@');
+                if (at != std::string_view::npos) {
+                    c.has_userinfo = true;
+                    c.userinfo = authority.substr(0, at);
+                    authority.remove_prefix(at + 1);
+                }
+
+                // port follows the closing bracket of an IPv6 address, or the last colon otherwise
+                std::size_t colon = std::string_view::npos;
+                if (!authority.empty() && authority[0] == '[') {
+                    std::size_t bracket = authority.find(']');
+                    if (bracket != std::string_view::npos && bracket + 1 < authority.size() && authority[bracket + 1] == ':') {
+                        colon = bracket + 1;
+                    }
+                } else {
+                    colon = authority.rfind(':');
+                }
+                if (colon != std::string_view::npos) {
+                    std::string_view port = authority.substr(colon + 1);
+                    if (std::all_of(port.begin(), port.end(), [](char ch) { return ch >= '0' && ch <= '9'; })) {
+                        c.has_port = true;
+                        c.port = port;
+                        authority = authority.substr(0, colon);
+                    }
+                }
+                c.host = authority;
+            }
+
+            std::size_t end = find(path_end, 0);
+            c.path = str.substr(0, end);
+            str.remove_prefix(end);
+
+            if (!str.empty() && str[0] == '?') {
+                c.has_query = true;
+                end = std::min(str.find('#'), str.size());
+                c.query = str.substr(1, end - 1);
+                str.remove_prefix(end);
+            }
+
+            if (!str.empty()) {
+                c.has_fragment = true;
+                c.fragment = str.substr(1);
+            }
+            return c;
+        }
+
+        /** Schemes identified by their index in the table rather than written as a token. */
+        constexpr std::string_view url_schemes[] = {
+            "http", "https", "ftp", "ftps", "ws", "wss", "file", "mailto", "data", "tel", "ssh", "git", "s3", "urn"
+        };
+
+        /** One more than the index of a scheme in the table of schemes, or 0 if the scheme is not in the table. */
+        inline unsigned int find_url_scheme(const std::string_view& scheme)
+        {
+            for (std::size_t k = 0; k < sizeof(url_schemes) / sizeof(url_schemes[0]); ++k) {
+                if (url_schemes[k] == scheme) {
+                    return static_cast<unsigned int>(k + 1);
+                }
+            }
+            return 0;
+        }
+
+        /**
+         * Top-level domains and public suffixes under which hosts are commonly registered.
+         *
+         * A suffix that extends another suffix (e.g. `co.uk` and `uk`) is matched in preference to the shorter one.
+         */
+        constexpr std::string_view public_suffixes[] = {
+            "com", "org", "net", "edu", "gov", "mil", "int", "info", "biz", "io", "co", "ai", "app", "dev", "me", "tv",
+            "us", "uk", "de", "fr", "nl", "it", "es", "eu", "ch", "se", "pl", "ru", "jp", "cn", "kr", "in", "br", "au", "ca",
+            "co.uk", "org.uk", "ac.uk", "gov.uk", "com.au", "net.au", "co.jp", "ne.jp", "com.br", "com.cn", "co.in", "co.kr",
+            "co.nz", "com.mx", "com.tr",
+            "amazonaws.com", "s3.amazonaws.com", "cloudfront.net", "googleapis.com", "appspot.com", "azurewebsites.net",
+            "blob.core.windows.net", "github.io", "herokuapp.com", "cloudflare.com", "akamaihd.net", "fastly.net"
+        };
+
+        /**
+         * One more than the index of the longest public suffix that matches the host, or 0 if none matches.
+         *
+         * A suffix matches if it is the entire host, or is preceded by a `.` in the host. Matching is case-sensitive.
+         */
+        inline unsigned int find_public_suffix(const std::string_view& host)
+        {
+            // try candidate suffixes starting at label boundaries from left to right, i.e. from longest to shortest
+            std::size_t start = 0;
+            while (start < host.size()) {
+                std::string_view candidate = host.substr(start);
+                for (std::size_t k = 0; k < sizeof(public_suffixes) / sizeof(public_suffixes[0]); ++k) {
+                    if (public_suffixes[k] == candidate) {
+                        return static_cast<unsigned int>(k + 1);
+                    }
+                }
+                std::size_t dot = host.find('.', start);
+                if (dot == std::string_view::npos) {
+                    break;
+                }
+                start = dot + 1;
+            }
+            return 0;
+        }
+    }
+}
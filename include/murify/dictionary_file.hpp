@@ -0,0 +1,211 @@
+/**
+ * murify: Efficient in-memory compression for URLs
+ * @see https://github.com/hunyadi/murify
+ *
+ * Copyright (c) 2024 Levente Hunyadi
+ *
+ * This work is licensed under the terms of the MIT license.
+ * For a copy, see <https://opensource.org/licenses/MIT>.
+ */
+
+#pragma once
+#include "compactor.hpp"
+#include "frozen_interned_store.hpp"
+
+#include <string>
+#include <fstream>
+#include <memory>
+#include <vector>
+#include <algorithm>
+#include <utility>
+#include <type_traits>
+#include <stdexcept>
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define MURIFY_HAS_MMAP 1
+#endif
+
+namespace murify
+{
+    namespace detail
+    {
+        template<typename Tokenizer, typename Store>
+        std::true_type is_compactor_base(const Compactor<Tokenizer, Store>*);
+
+        std::false_type is_compactor_base(const void*);
+
+        /** True if a type is a compactor, or derives from one, e.g. `FrozenScopedURLCompactor`. */
+        template<typename T>
+        using is_compactor = decltype(is_compactor_base(static_cast<const T*>(nullptr)));
+
+        /** Writes the buffer of a frozen store, padded such that a buffer that follows is aligned to 8 bytes. */
+        inline void write_dictionary(std::ostream& out, const frozen_interned_store& store)
+        {
+            constexpr static char padding[sizeof(std::uint64_t)] = {};
+            auto bytes = store.bytes();
+            out.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+            out.write(padding, static_cast<std::streamsize>((sizeof(padding) - bytes.size() % sizeof(padding)) % sizeof(padding)));
+        }
+
+        template<typename Store>
+        void write_dictionary(std::ostream& out, const Store& store)
+        {
+            write_dictionary(out, frozen_interned_store(store));
+        }
+
+        /**
+         * The contents of a dictionary file, which holds the buffers of one or more frozen stores back to back.
+         *
+         * Where supported, the file is mapped into memory read-only, and stores use the mapped pages directly.
+         * Elsewhere, the file is read into memory.
+         */
+        struct dictionary_reader
+        {
+            explicit dictionary_reader(const std::string& path)
+            {
+#if defined(MURIFY_HAS_MMAP)
+                int fd = ::open(path.c_str(), O_RDONLY);
+                if (fd < 0) {
+                    throw std::runtime_error("cannot open dictionary: " + path);
+                }
+                struct stat st;
+                if (::fstat(fd, &st) != 0) {
+                    ::close(fd);
+                    throw std::runtime_error("cannot open dictionary: " + path);
+                }
+                std::size_t size = static_cast<std::size_t>(st.st_size);
+                if (size == 0) {
+                    ::close(fd);
+                    throw std::runtime_error("dictionary truncated");
+                }
+                void* data = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+                ::close(fd);
+                if (data == MAP_FAILED) {
+                    throw std::runtime_error("cannot map dictionary: " + path);
+                }
+
+                // mapping is released when the last store that uses it is destroyed
+                _owner = std::shared_ptr<const void>(data, [size](const void* p) {
+                    ::munmap(const_cast<void*>(p), size);
+                });
+                _data = static_cast<const std::byte*>(data);
+                _size = size;
+#else
+                std::ifstream in(path, std::ios::binary | std::ios::ate);
+                if (!in) {
+                    throw std::runtime_error("cannot open dictionary: " + path);
+                }
+                std::size_t size = static_cast<std::size_t>(in.tellg());
+                std::shared_ptr<std::uint64_t[]> buffer(new std::uint64_t[(size + sizeof(std::uint64_t) - 1) / sizeof(std::uint64_t)]);
+                in.seekg(0);
+                in.read(reinterpret_cast<char*>(buffer.get()), static_cast<std::streamsize>(size));
+                if (!in) {
+                    throw std::runtime_error("cannot read dictionary: " + path);
+                }
+                _data = reinterpret_cast<const std::byte*>(buffer.get());
+                _size = size;
+                _owner = std::move(buffer);
+#endif
+            }
+
+            /** Uses the buffer of the next store in the file without copying. */
+            frozen_interned_store next()
+            {
+                std::size_t offset = std::min(_offset, _size);
+                frozen_interned_store store(_data + offset, _size - offset, _owner);
+                _offset = offset + (store.bytes().size() + sizeof(std::uint64_t) - 1) / sizeof(std::uint64_t) * sizeof(std::uint64_t);
+                return store;
+            }
+
+        private:
+            std::shared_ptr<const void> _owner;
+            const std::byte* _data = nullptr;
+            std::size_t _size = 0;
+            std::size_t _offset = 0;
+        };
+    }
+
+    /**
+     * Writes the strings of a store to a dictionary file, preserving their ordinals.
+     *
+     * The file holds the buffer of a `frozen_interned_store` as is, which `load_dictionary` can use without parsing.
+     */
+    inline void save_dictionary(const std::string& path, const frozen_interned_store& store)
+    {
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        detail::write_dictionary(out, store);
+        out.close();
+        if (!out) {
+            throw std::runtime_error("cannot write dictionary: " + path);
+        }
+    }
+
+    /**
+     * Writes the strings of a store or of a compactor to a dictionary file, preserving their ordinals.
+     *
+     * For a compactor, the buffer of its store is followed by the dictionaries of the tokenizer, if any: for each
+     * `context_store`, a buffer with the names of contexts, and a buffer for each context in the order of its name.
+     */
+    template<typename Dictionary>
+    void save_dictionary(const std::string& path, const Dictionary& dictionary)
+    {
+        if constexpr (detail::is_compactor<Dictionary>::value) {
+            std::ofstream out(path, std::ios::binary | std::ios::trunc);
+            detail::write_dictionary(out, dictionary.store());
+            dictionary.contexts().for_each([&out](const auto& contexts) {
+                detail::write_dictionary(out, contexts.names());
+                for (auto it = contexts.names().begin(); it != contexts.names().end(); ++it) {
+                    detail::write_dictionary(out, contexts.find(*it));
+                }
+            });
+            out.close();
+            if (!out) {
+                throw std::runtime_error("cannot write dictionary: " + path);
+            }
+        } else {
+            save_dictionary(path, frozen_interned_store(dictionary));
+        }
+    }
+
+    /**
+     * Opens a dictionary file written with `save_dictionary`.
+     *
+     * Where supported, the file is mapped into memory read-only, and the store uses the mapped pages directly, such
+     * that loading takes constant time, and processes that load the same dictionary share its pages through the page
+     * cache. Elsewhere, the file is read into memory.
+     */
+    inline frozen_interned_store load_dictionary(const std::string& path)
+    {
+        return detail::dictionary_reader(path).next();
+    }
+
+    /**
+     * Opens a dictionary file written with `save_dictionary` from a compactor, and creates a compactor with a frozen
+     * store, e.g. `FrozenScopedURLCompactor`, that uses the dictionaries of the tokenizer saved in the file.
+     *
+     * A file without the dictionaries the tokenizer keeps, e.g. one written from a store only, is rejected.
+     */
+    template<typename FrozenCompactor>
+    FrozenCompactor load_dictionary(const std::string& path)
+    {
+        detail::dictionary_reader reader(path);
+        frozen_interned_store store = reader.next();
+        typename FrozenCompactor::context_type contexts;
+        contexts.for_each([&reader](auto& context) {
+            frozen_interned_store names = reader.next();
+            std::vector<frozen_interned_store> scopes;
+            scopes.reserve(names.count());
+            for (std::size_t k = 0; k < names.count(); ++k) {
+                scopes.push_back(reader.next());
+            }
+            context = std::decay_t<decltype(context)>(std::move(names), std::move(scopes));
+        });
+        return FrozenCompactor(std::move(store), std::move(contexts));
+    }
+}
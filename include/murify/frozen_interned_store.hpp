@@ -0,0 +1,285 @@
+/**
+ * murify: Efficient in-memory compression for URLs
+ * @see https://github.com/hunyadi/murify
+ *
+ * Copyright (c) 2024 Levente Hunyadi
+ *
+ * This work is licensed under the terms of the MIT license.
+ * For a copy, see <https://opensource.org/licenses/MIT>.
+ */
+
+#pragma once
+#include "interned_string.hpp"
+#include "detail/hash_index.hpp"
+
+#include <string_view>
+#include <memory>
+#include <stdexcept>
+#include <cstdint>
+#include <cstring>
+
+namespace murify
+{
+    /**
+     * An immutable snapshot of an indexed array of strings, optimized for lookups.
+     *
+     * All data lives in a single buffer that doubles as an on-disk format:
+     *
+     * ```
+     * header   magic, version, byte order mark, string count, slot count and character count
+     * slots    hash table of (upper 32 bits of hash, ordinal plus one) pairs with load factor at most 1/2
+     * offsets  offset of each string in the character array, followed by the total number of characters
+     * chars    null-terminated characters of all strings back to back
+     * ```
+     *
+     * The hash function is identical across processes, which lets a store use a buffer that has been written to disk
+     * and mapped into memory as is, without rebuilding the hash table. Strings cannot be added, which lets any number
+     * of threads use the store without synchronization.
+     */
+    struct frozen_interned_store
+    {
+        /** Strings cannot be added to the store. */
+        constexpr static bool read_only = true;
+
+        /** Identifies the on-disk format. */
+        constexpr static char magic[8] = { 'M', 'U', 'R', 'I', 'F', 'Y', 'D', 0 };
+        constexpr static std::uint32_t version = 1;
+
+        frozen_interned_store() = default;
+
+        frozen_interned_store(const frozen_interned_store&) = delete;
+        frozen_interned_store& operator=(const frozen_interned_store&) = delete;
+        frozen_interned_store(frozen_interned_store&&) = default;
+        frozen_interned_store& operator=(frozen_interned_store&&) = default;
+
+        /** Takes a snapshot of the strings in a store, preserving their ordinals. */
+        template<typename Store>
+        explicit frozen_interned_store(const Store& store)
+        {
+            std::size_t count = store.count();
+            if (count >= 0xffffffffu / 2) {
+                throw std::length_error("too many strings to freeze");
+            }
+
+            std::size_t length = 0;
+            for (auto it = store.begin(); it != store.end(); ++it) {
+                length += (*it).size() + 1;
+            }
+            if (length > 0xffffffffu) {
+                throw std::length_error("too many characters to freeze");
+            }
+
+            std::size_t capacity = 1;
+            while (capacity < 2 * count) {
+                capacity *= 2;
+            }
+
+            layout l(static_cast<std::uint32_t>(count), static_cast<std::uint32_t>(capacity), static_cast<std::uint32_t>(length));
+            std::shared_ptr<std::uint64_t[]> buffer(new std::uint64_t[(l.size + sizeof(std::uint64_t) - 1) / sizeof(std::uint64_t)]);
+            std::byte* base = reinterpret_cast<std::byte*>(buffer.get());
+            std::memset(base, 0, l.size);
+
+            header h{};
+            std::memcpy(h.magic, magic, sizeof(magic));
+            h.version = version;
+            h.byte_order = byte_order_mark;
+            h.count = l.count;
+            h.capacity = l.capacity;
+            h.length = l.length;
+            std::memcpy(base, &h, sizeof(header));
+
+            slot* slots = reinterpret_cast<slot*>(base + l.slots);
+            std::uint32_t* offsets = reinterpret_cast<std::uint32_t*>(base + l.offsets);
+            char* chars = reinterpret_cast<char*>(base + l.chars);
+
+            std::uint32_t index = 0;
+            std::uint32_t offset = 0;
+            for (auto it = store.begin(); it != store.end(); ++it, ++index) {
+                std::string_view str = *it;
+                offsets[index] = offset;
+                std::memcpy(chars + offset, str.data(), str.size());
+                chars[offset + str.size()] = 0;
+                offset += static_cast<std::uint32_t>(str.size() + 1);
+
+                std::uint64_t hash = detail::hash_bytes(str.data(), str.size());
+                std::uint32_t upper = static_cast<std::uint32_t>(hash >> 32);
+                std::size_t k = upper & (capacity - 1);
+                while (slots[k].index != 0) {
+                    k = (k + 1) & (capacity - 1);
+                }
+                slots[k] = slot{ upper, index + 1 };
+            }
+            offsets[count] = offset;
+
+            attach(base, l);
+            _size_bytes = l.size;
+            _owner = std::move(buffer);
+        }
+
+        /**
+         * Uses a buffer produced by `bytes()`, e.g. a file mapped into memory, without copying.
+         *
+         * Only the header is validated, which takes constant time. The buffer must be aligned to 8 bytes, and must
+         * remain valid while the store is in use; `owner` (if any) is kept alive together with the store.
+         */
+        frozen_interned_store(const void* data, std::size_t size, std::shared_ptr<const void> owner = nullptr)
+        {
+            if (reinterpret_cast<std::uintptr_t>(data) % alignof(std::uint64_t) != 0) {
+                throw std::invalid_argument("dictionary buffer must be aligned to 8 bytes");
+            }
+            if (size < sizeof(header)) {
+                throw std::runtime_error("dictionary truncated");
+            }
+
+            header h;
+            std::memcpy(&h, data, sizeof(header));
+            if (std::memcmp(h.magic, magic, sizeof(magic)) != 0) {
+                throw std::runtime_error("not a dictionary");
+            }
+            if (h.byte_order != byte_order_mark) {
+                throw std::runtime_error("dictionary byte order mismatch");
+            }
+            if (h.version != version) {
+                throw std::runtime_error("dictionary version not supported");
+            }
+            if (h.capacity == 0 || (h.capacity & (h.capacity - 1)) != 0 || 2 * std::uint64_t(h.count) > h.capacity) {
+                throw std::runtime_error("dictionary corrupt");
+            }
+
+            layout l(h.count, h.capacity, h.length);
+            if (size < l.size) {
+                throw std::runtime_error("dictionary truncated");
+            }
+
+            attach(static_cast<const std::byte*>(data), l);
+            if (_offsets[_count] != h.length) {
+                throw std::runtime_error("dictionary corrupt");
+            }
+            _size_bytes = l.size;
+            _owner = std::move(owner);
+        }
+
+        /** The buffer that holds all data of the store, which may be written to disk as is. */
+        std::basic_string_view<std::byte> bytes() const
+        {
+            return std::basic_string_view<std::byte>(_base, _size_bytes);
+        }
+
+        /** The characters of a string stored in the indexed array. */
+        const char* data(const interned_string& s) const
+        {
+            return _chars + _offsets[s.index()];
+        }
+
+        /** String length. */
+        std::size_t size(const interned_string& s) const
+        {
+            return _offsets[s.index() + 1] - _offsets[s.index()] - 1;
+        }
+
+        /** A string view over the characters stored in the indexed array. */
+        std::string_view str(const interned_string& s) const
+        {
+            return std::string_view(data(s), size(s));
+        }
+
+        using const_iterator = interned_store_iterator<frozen_interned_store>;
+
+        /** Number of strings stored in the indexed array. */
+        std::size_t count() const
+        {
+            return _count;
+        }
+
+        const_iterator begin() const
+        {
+            return const_iterator(*this, 0);
+        }
+
+        const_iterator end() const
+        {
+            return const_iterator(*this, static_cast<std::uint32_t>(count()));
+        }
+
+        /** Looks up the ordinal of a string. */
+        bool find(const std::string_view& str, interned_string& s) const
+        {
+            if (_count == 0) {
+                return false;
+            }
+
+            std::uint64_t hash = detail::hash_bytes(str.data(), str.size());
+            std::uint32_t upper = static_cast<std::uint32_t>(hash >> 32);
+            for (std::size_t k = upper & _mask; _slots[k].index != 0; k = (k + 1) & _mask) {
+                if (_slots[k].hash == upper) {
+                    interned_string candidate(_slots[k].index - 1);
+                    if (this->str(candidate) == str) {
+                        s = candidate;
+                        return true;
+                    }
+                }
+            }
+            return false;
+        }
+
+    private:
+        constexpr static std::uint32_t byte_order_mark = 0x01020304u;
+
+        struct header
+        {
+            char magic[8];
+            std::uint32_t version;
+            std::uint32_t byte_order;
+            std::uint32_t count;
+            std::uint32_t capacity;
+            std::uint32_t length;
+            std::uint32_t reserved;
+        };
+
+        struct slot
+        {
+            std::uint32_t hash;
+            std::uint32_t index;
+        };
+
+        /** Byte offsets of the sections in the buffer, each aligned to 8 bytes. */
+        struct layout
+        {
+            layout(std::uint32_t count, std::uint32_t capacity, std::uint32_t length)
+                : count(count), capacity(capacity), length(length)
+            {
+                slots = sizeof(header);
+                offsets = slots + std::size_t(capacity) * sizeof(slot);
+                chars = offsets + ((std::size_t(count) + 1) * sizeof(std::uint32_t) + 7) / 8 * 8;
+                size = chars + length;
+            }
+
+            std::uint32_t count;
+            std::uint32_t capacity;
+            std::uint32_t length;
+            std::size_t slots;
+            std::size_t offsets;
+            std::size_t chars;
+            std::size_t size;
+        };
+
+        void attach(const std::byte* base, const layout& l)
+        {
+            _base = base;
+            _slots = reinterpret_cast<const slot*>(base + l.slots);
+            _mask = l.capacity - 1;
+            _offsets = reinterpret_cast<const std::uint32_t*>(base + l.offsets);
+            _chars = reinterpret_cast<const char*>(base + l.chars);
+            _count = l.count;
+        }
+
+        std::shared_ptr<const void> _owner;
+        const std::byte* _base = nullptr;
+        std::size_t _size_bytes = 0;
+        const slot* _slots = nullptr;
+        std::size_t _mask = 0;
+        const std::uint32_t* _offsets = nullptr;
+        const char* _chars = nullptr;
+        std::size_t _count = 0;
+    };
+}
@@ -9,10 +9,14 @@
  */
 
 #pragma once
+#include "detail/hash_index.hpp"
+
 #include <string_view>
 #include <string>
-#include <unordered_map>
 #include <vector>
+#include <memory>
+#include <algorithm>
+#include <stdexcept>
 #include <cstdint>
 #include <cstring>
 
@@ -52,30 +56,86 @@ namespace murify
         std::uint32_t _index = 0;
     };
 
+    /**
+     * Iterates over the strings of an indexed array of strings in order of their ordinals.
+     */
+    template<typename Store>
+    struct interned_store_iterator
+    {
+        interned_store_iterator(const Store& ref, std::uint32_t index)
+            : _ref(ref), _index(index)
+        {
+        }
+
+        bool operator==(const interned_store_iterator& op) const
+        {
+            return &_ref == &op._ref && _index == op._index;
+        }
+
+        bool operator!=(const interned_store_iterator& op) const
+        {
+            return &_ref != &op._ref || _index != op._index;
+        }
+
+        std::string_view operator*() const
+        {
+            return _ref.str(interned_string(_index));
+        }
+
+        interned_store_iterator& operator++()
+        {
+            ++_index;
+            return *this;
+        }
+
+        interned_store_iterator operator++(int)
+        {
+            interned_store_iterator result = *this;
+            ++_index;
+            return result;
+        }
+
+    private:
+        const Store& _ref;
+        std::uint32_t _index;
+    };
+
     /**
      * Maps strings into ordinals of an indexed array of strings.
+     *
+     * Characters are stored back to back in large chunks of memory, and each string is identified by a 32-bit offset
+     * and a 32-bit length. The upper 16 bits of the offset select a chunk, and the lower 16 bits a position within it,
+     * which caps the number of chunks at 65536. The first chunk is small, and chunk size doubles until it reaches
+     * 64 KiB, such that stores with few strings remain small. A string longer than the space left gets a chunk of its
+     * own, which may exceed 64 KiB; total storage is thus at most 4 GiB plus the size of such oversized strings.
+     *
+     * Strings are looked up with a flat open-addressing hash index, which keeps the hash and ordinal of each string
+     * side by side, such that a lookup typically reads a single group of control bytes and a single slot before
+     * comparing characters.
      */
     struct interned_store
     {
+        /** Strings can be added to the store. */
+        constexpr static bool read_only = false;
+
         interned_store() = default;
 
         interned_store(const interned_store&) = delete;
-
-        ~interned_store()
-        {
-            clear();
-        }
+        interned_store& operator=(const interned_store&) = delete;
+        interned_store(interned_store&&) = default;
+        interned_store& operator=(interned_store&&) = default;
 
         /** The characters of a string stored in the indexed array. */
         const char* data(const interned_string& s) const
         {
-            return _data[s.index()] + sizeof(std::size_t);
+            const entry& e = _entries[s.index()];
+            return _chunks[e.offset >> chunk_shift].get() + (e.offset & (chunk_size - 1));
         }
 
         /** String length. */
         std::size_t size(const interned_string& s) const
         {
-            return *reinterpret_cast<const std::size_t*>(_data[s.index()]);
+            return _entries[s.index()].size;
         }
 
         /** A string view over the characters stored in the indexed array. */
@@ -84,50 +144,12 @@ namespace murify
             return std::string_view(data(s), size(s));
         }
 
-        struct const_iterator
-        {
-            const_iterator(const interned_store& ref, std::uint32_t index)
-                : _ref(ref), _index(index)
-            {
-            }
-
-            bool operator==(const const_iterator& op) const
-            {
-                return &_ref == &op._ref && _index == op._index;
-            }
-
-            bool operator!=(const const_iterator& op) const
-            {
-                return &_ref != &op._ref || _index != op._index;
-            }
-
-            std::string_view operator*() const
-            {
-                return interned_string(_index).str(_ref);
-            }
-
-            const_iterator& operator++()
-            {
-                ++_index;
-                return *this;
-            }
-
-            const_iterator operator++(int)
-            {
-                const_iterator result = *this;
-                ++_index;
-                return result;
-            }
-
-        private:
-            const interned_store& _ref;
-            std::uint32_t _index;
-        };
+        using const_iterator = interned_store_iterator<interned_store>;
 
         /** Number of strings stored in the indexed array. */
         std::size_t count() const
         {
-            return _table.size();
+            return _entries.size();
         }
 
         const_iterator begin() const
@@ -143,12 +165,11 @@ namespace murify
         /** Deallocates and removes all strings in the indexed array. */
         void clear()
         {
-            _table.clear();
-            for (auto it = _data.begin(); it != _data.end(); ++it)
-            {
-                delete (*it);
-            }
-            _data.clear();
+            _index.clear();
+            _entries.clear();
+            _chunks.clear();
+            _chunk_used = 0;
+            _chunk_capacity = 0;
         }
 
         interned_string intern(const char* beg, const char* end)
@@ -166,31 +187,80 @@ namespace murify
             return intern(std::string_view(str.data(), str.size()));
         }
 
+        /** Looks up the ordinal of a string without adding it to the indexed array. */
+        bool find(const std::string_view& str, interned_string& s) const
+        {
+            std::uint32_t index;
+            std::uint64_t hash = detail::hash_bytes(str.data(), str.size());
+            auto equals = [this, &str](std::uint32_t i) {
+                return this->str(interned_string(i)) == str;
+            };
+            if (!_index.find(hash, equals, index)) {
+                return false;
+            }
+            s = interned_string(index);
+            return true;
+        }
+
         /** Adds a new string to the indexed array and assigns an ordinal to the interned string. */
         interned_string intern(const std::string_view& str)
         {
             std::uint32_t index;
-            auto it = _table.find(str);
-            if (it != _table.end())
+            std::uint64_t hash = detail::hash_bytes(str.data(), str.size());
+            auto equals = [this, &str](std::uint32_t i) {
+                return this->str(interned_string(i)) == str;
+            };
+            if (!_index.find(hash, equals, index))
             {
-                index = it->second;
-            } else
-            {
-                char* ptr = new char[sizeof(std::size_t) + str.size() + 1];
-                *reinterpret_cast<std::size_t*>(ptr) = str.size();
-                char* s = ptr + sizeof(std::size_t);
-                std::memcpy(s, str.data(), str.size());
+                // characters are followed by a terminating null character
+                std::uint32_t offset = allocate(str.size() + 1);
+                char* s = _chunks.back().get() + (offset & (chunk_size - 1));
+                std::copy_n(str.data(), str.size(), s);
                 s[str.size()] = 0;
-                index = static_cast<std::uint32_t>(_data.size());
-                _data.push_back(ptr);
-                _table.insert(std::make_pair(std::string_view(s, str.size()), index));
+                index = static_cast<std::uint32_t>(_entries.size());
+                _entries.push_back(entry{ offset, static_cast<std::uint32_t>(str.size()) });
+                _index.insert(hash, index);
             }
             return interned_string(index);
         }
 
     private:
-        std::unordered_map<std::string_view, std::uint32_t> _table;
-        std::vector<const char*> _data;
+        struct entry
+        {
+            std::uint32_t offset;
+            std::uint32_t size;
+        };
+
+        constexpr static unsigned int chunk_shift = 16;
+        constexpr static std::size_t chunk_size = std::size_t(1) << chunk_shift;
+        constexpr static std::size_t initial_chunk_size = 256;
+        constexpr static std::size_t max_chunk_count = std::size_t(1) << (32 - chunk_shift);
+
+        /** Reserves space in the last chunk, and returns the offset of the reserved space. */
+        std::uint32_t allocate(std::size_t n)
+        {
+            if (_chunks.empty() || _chunk_capacity - _chunk_used < n) {
+                if (_chunks.size() >= max_chunk_count) {
+                    throw std::length_error("interned string storage exhausted");
+                }
+
+                // oversized strings get a chunk of their own
+                std::size_t capacity = _chunks.empty() ? initial_chunk_size : std::min(2 * _chunk_capacity, chunk_size);
+                _chunk_capacity = std::max(capacity, n);
+                _chunk_used = 0;
+                _chunks.emplace_back(new char[_chunk_capacity]);
+            }
+
+            std::size_t offset = ((_chunks.size() - 1) << chunk_shift) + _chunk_used;
+            _chunk_used += n;
+            return static_cast<std::uint32_t>(offset);
+        }
+
+        detail::hash_index _index;
+        std::vector<entry> _entries;
+        std::vector<std::unique_ptr<char[]>> _chunks;
+        std::size_t _chunk_used = 0;
+        std::size_t _chunk_capacity = 0;
     };
 
     inline const char* interned_string::data(const interned_store& store) const
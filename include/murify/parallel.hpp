@@ -0,0 +1,376 @@
+/**
+ * murify: Efficient in-memory compression for URLs
+ * @see https://github.com/hunyadi/murify
+ *
+ * Copyright (c) 2024 Levente Hunyadi
+ *
+ * This work is licensed under the terms of the MIT license.
+ * For a copy, see <https://opensource.org/licenses/MIT>.
+ */
+
+#pragma once
+#include "compactor.hpp"
+#include "batch.hpp"
+#include "context_store.hpp"
+#include "interned_string.hpp"
+#include "sink.hpp"
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <fstream>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <exception>
+#include <algorithm>
+#include <stdexcept>
+#include <cstddef>
+
+namespace murify
+{
+    namespace detail
+    {
+        /**
+         * Invokes a function on each index in `[0, count)` on several threads.
+         *
+         * Threads claim the next unprocessed index from a shared counter, such that threads that finish early take
+         * over work that would otherwise wait for slower threads. The first exception thrown is re-thrown on the
+         * calling thread after all threads have finished.
+         */
+        template<typename Fn>
+        void parallel_for(std::size_t count, std::size_t thread_count, Fn&& fn)
+        {
+            thread_count = std::min(thread_count, count);
+            if (thread_count <= 1) {
+                for (std::size_t k = 0; k < count; ++k) {
+                    fn(k);
+                }
+                return;
+            }
+
+            std::atomic<std::size_t> next{ 0 };
+            std::exception_ptr error;
+            std::mutex error_mutex;
+            auto work = [&]() {
+                try {
+                    for (std::size_t k = next.fetch_add(1, std::memory_order_relaxed); k < count; k = next.fetch_add(1, std::memory_order_relaxed)) {
+                        fn(k);
+                    }
+                } catch (...) {
+                    // skip remaining work
+                    next.store(count, std::memory_order_relaxed);
+                    std::lock_guard<std::mutex> lock(error_mutex);
+                    if (!error) {
+                        error = std::current_exception();
+                    }
+                }
+            };
+
+            std::vector<std::thread> threads;
+            threads.reserve(thread_count - 1);
+            for (std::size_t t = 1; t < thread_count; ++t) {
+                threads.emplace_back(work);
+            }
+            work();
+            for (auto&& thread : threads) {
+                thread.join();
+            }
+            if (error) {
+                std::rethrow_exception(error);
+            }
+        }
+
+        /**
+         * A store that collects strings not found in another store, in first-seen order.
+         */
+        template<typename Store>
+        struct collecting_store
+        {
+            constexpr static bool read_only = false;
+
+            explicit collecting_store(const Store& base)
+                : _base(&base)
+            {
+            }
+
+            interned_string intern(const std::string_view& str)
+            {
+                interned_string s;
+                if (!_base->find(str, s)) {
+                    _strings.intern(str);
+                }
+                return s;
+            }
+
+            std::string_view str(const interned_string& s) const
+            {
+                return _base->str(s);
+            }
+
+            /** Takes the strings not found in the other store, in first-seen order. */
+            interned_store release()
+            {
+                return std::move(_strings);
+            }
+
+        private:
+            const Store* _base;
+            interned_store _strings;
+        };
+
+        /**
+         * A read-only view of another store, which must not be modified while the view is in use.
+         */
+        template<typename Store>
+        struct store_view
+        {
+            constexpr static bool read_only = true;
+
+            explicit store_view(const Store& store)
+                : _store(&store)
+            {
+            }
+
+            bool find(const std::string_view& str, interned_string& s) const
+            {
+                return _store->find(str, s);
+            }
+
+            std::string_view str(const interned_string& s) const
+            {
+                return _store->str(s);
+            }
+
+        private:
+            const Store* _store;
+        };
+    }
+
+    /**
+     * A read-only view of the contexts of another context store, which must not be modified while the view is in use.
+     */
+    template<typename Store>
+    struct context_store<detail::store_view<Store>>
+    {
+        constexpr static bool read_only = true;
+
+        /** A read-only view of the store of a single context. */
+        using scope_type = detail::store_view<typename context_store<Store>::scope_type>;
+
+        explicit context_store(const context_store<Store>& contexts)
+            : _contexts(&contexts)
+        {
+        }
+
+        /** Number of contexts. */
+        std::size_t count() const
+        {
+            return _contexts->count();
+        }
+
+        /** The store of a context, or an empty store if the context has not been seen. */
+        scope_type find(const std::string_view& context) const
+        {
+            return scope_type(_contexts->find(context));
+        }
+
+        /** The store of a context, or an empty store if the context has not been seen. */
+        scope_type scope(const std::string_view& context) const
+        {
+            return find(context);
+        }
+
+    private:
+        const context_store<Store>* _contexts;
+    };
+
+    /**
+     * Options for parallel compaction and expansion.
+     */
+    struct parallel_options
+    {
+        /** Number of threads to use, or 0 to use all hardware threads. */
+        std::size_t thread_count = 0;
+
+        /** Number of URLs a thread processes at a time. */
+        std::size_t chunk_size = 4096;
+
+        std::size_t threads() const
+        {
+            if (thread_count != 0) {
+                return thread_count;
+            }
+            std::size_t n = std::thread::hardware_concurrency();
+            return n != 0 ? n : 1;
+        }
+    };
+
+    /**
+     * Lines of a text file, such as a file with one URL per line.
+     */
+    struct text_lines
+    {
+        /** Reads a file, and splits its contents at line breaks. A carriage return before a line feed is dropped. */
+        explicit text_lines(const std::string& path)
+        {
+            std::ifstream in(path, std::ios::binary | std::ios::ate);
+            if (!in) {
+                throw std::runtime_error("cannot open file: " + path);
+            }
+            _contents.resize(static_cast<std::size_t>(in.tellg()));
+            in.seekg(0);
+            in.read(_contents.data(), static_cast<std::streamsize>(_contents.size()));
+            if (!in) {
+                throw std::runtime_error("cannot read file: " + path);
+            }
+
+            std::string_view contents(_contents);
+            while (!contents.empty()) {
+                std::size_t end = contents.find('\n');
+                std::string_view line = contents.substr(0, end);
+                if (!line.empty() && line.back() == '\r') {
+                    line.remove_suffix(1);
+                }
+                _lines.push_back(line);
+                contents.remove_prefix(end != std::string_view::npos ? end + 1 : contents.size());
+            }
+        }
+
+        text_lines(const text_lines&) = delete;
+        text_lines& operator=(const text_lines&) = delete;
+
+        std::size_t size() const
+        {
+            return _lines.size();
+        }
+
+        std::string_view operator[](std::size_t index) const
+        {
+            return _lines[index];
+        }
+
+        std::vector<std::string_view>::const_iterator begin() const
+        {
+            return _lines.begin();
+        }
+
+        std::vector<std::string_view>::const_iterator end() const
+        {
+            return _lines.end();
+        }
+
+    private:
+        std::string _contents;
+        std::vector<std::string_view> _lines;
+    };
+
+    /**
+     * Compacts a range of URLs into a batch on several threads.
+     *
+     * The output is identical to that of calling `compact` on each URL in order on a single thread, regardless of the
+     * number of threads. URLs are processed in waves of chunks. First, threads tokenize chunks and collect strings
+     * not yet in the store, and strings of each context of a tokenizer with scoped dictionaries. Next, the collected
+     * strings are interned in chunk order on the calling thread, which assigns exactly the ordinals that sequential
+     * compaction would assign. Finally, threads encode chunks against
+     * the store, which no longer changes until the next wave.
+     *
+     * @param urls A random-access range whose elements convert to `std::string_view`.
+     */
+    template<typename Tokenizer, typename Store, typename Range>
+    void parallel_compact_batch(Compactor<Tokenizer, Store>& compactor, const Range& urls, batch& out, const parallel_options& options = parallel_options())
+    {
+        std::size_t count = urls.size();
+        std::size_t chunk_size = std::max<std::size_t>(options.chunk_size, 1);
+        std::size_t chunk_count = (count + chunk_size - 1) / chunk_size;
+        std::size_t thread_count = options.threads();
+        std::size_t wave_size = 4 * thread_count;
+
+        Store& store = compactor.store();
+        std::vector<batch> chunks(std::min(wave_size, chunk_count));
+        for (std::size_t first = 0; first < chunk_count; first += wave_size) {
+            std::size_t wave_count = std::min(wave_size, chunk_count - first);
+            auto chunk_begin = [&](std::size_t k) {
+                return (first + k) * chunk_size;
+            };
+            auto chunk_end = [&](std::size_t k) {
+                return std::min((first + k + 1) * chunk_size, count);
+            };
+
+            if constexpr (!Store::read_only) {
+                using collector_type = Compactor<Tokenizer, detail::collecting_store<Store>>;
+                std::vector<interned_store> collected(wave_count);
+                std::vector<typename collector_type::context_type> collected_contexts(wave_count);
+                detail::parallel_for(wave_count, thread_count, [&](std::size_t k) {
+                    collector_type collector{ detail::collecting_store<Store>(store) };
+                    std::byte discard[1];
+                    for (std::size_t i = chunk_begin(k); i < chunk_end(k); ++i) {
+                        byte_span_sink sink(discard, 0);
+                        collector.compact_into(std::string_view(urls[i]), sink);
+                    }
+                    collected[k] = collector.store().release();
+                    collected_contexts[k] = std::move(collector.contexts());
+                });
+
+                // merging in chunk order reproduces the order in which strings are first seen
+                for (std::size_t k = 0; k < wave_count; ++k) {
+                    for (auto&& str : collected[k]) {
+                        store.intern(str);
+                    }
+                    compactor.contexts().merge(collected_contexts[k]);
+                }
+            }
+
+            detail::parallel_for(wave_count, thread_count, [&](std::size_t k) {
+                using encoder_type = Compactor<Tokenizer, detail::store_view<Store>>;
+                encoder_type encoder{ detail::store_view<Store>(store), typename encoder_type::context_type(compactor.contexts()) };
+                batch& chunk = chunks[k];
+                chunk.clear();
+                for (std::size_t i = chunk_begin(k); i < chunk_end(k); ++i) {
+                    chunk.emplace_back([&encoder, &urls, i](byte_string_sink& sink) {
+                        encoder.compact_into(std::string_view(urls[i]), sink);
+                    });
+                }
+            });
+
+            for (std::size_t k = 0; k < wave_count; ++k) {
+                out.append(chunks[k]);
+            }
+        }
+    }
+
+    /**
+     * Compacts a range of URLs into a batch on several threads.
+     *
+     * @see parallel_compact_batch
+     */
+    template<typename Tokenizer, typename Store, typename Range>
+    batch parallel_compact_batch(Compactor<Tokenizer, Store>& compactor, const Range& urls, const parallel_options& options = parallel_options())
+    {
+        batch out;
+        parallel_compact_batch(compactor, urls, out, options);
+        return out;
+    }
+
+    /**
+     * Expands all items of a batch into full URLs on several threads.
+     *
+     * The store and the scoped dictionaries of the compactor must not be modified while expansion is in progress.
+     */
+    template<typename Tokenizer, typename Store>
+    std::vector<std::string> parallel_expand_batch(const Compactor<Tokenizer, Store>& compactor, const batch& b, const parallel_options& options = parallel_options())
+    {
+        std::vector<std::string> out(b.size());
+        std::size_t chunk_size = std::max<std::size_t>(options.chunk_size, 1);
+        std::size_t chunk_count = (b.size() + chunk_size - 1) / chunk_size;
+        detail::parallel_for(chunk_count, options.threads(), [&](std::size_t k) {
+            using decoder_type = Compactor<Tokenizer, detail::store_view<Store>>;
+            decoder_type decoder{ detail::store_view<Store>(compactor.store()), typename decoder_type::context_type(compactor.contexts()) };
+            for (std::size_t i = k * chunk_size; i < std::min((k + 1) * chunk_size, b.size()); ++i) {
+                string_sink sink(out[i]);
+                decoder.expand_into(b[i], sink);
+            }
+        });
+        return out;
+    }
+}
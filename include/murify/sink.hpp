@@ -0,0 +1,140 @@
+/**
+ * murify: Efficient in-memory compression for URLs
+ * @see https://github.com/hunyadi/murify
+ *
+ * Copyright (c) 2024 Levente Hunyadi
+ *
+ * This work is licensed under the terms of the MIT license.
+ * For a copy, see <https://opensource.org/licenses/MIT>.
+ */
+
+#pragma once
+#include <string>
+#include <cstddef>
+#include <cstring>
+
+namespace murify
+{
+    /**
+     * Appends output to the end of an existing string.
+     *
+     * Bytes already in the string are preserved; reusing a string whose capacity has been reserved in advance
+     * avoids heap allocations.
+     */
+    template<typename CharT>
+    struct basic_string_sink
+    {
+        using char_type = CharT;
+
+        explicit basic_string_sink(std::basic_string<CharT>& str)
+            : _str(str), _start(str.size())
+        {
+        }
+
+        void push_back(CharT c)
+        {
+            _str.push_back(c);
+        }
+
+        void append(const CharT* s, std::size_t n)
+        {
+            _str.append(s, n);
+        }
+
+        /** Appends `n` uninitialized characters, and returns a pointer to the first of them. */
+        CharT* extend(std::size_t n)
+        {
+            std::size_t pos = _str.size();
+            _str.resize(pos + n);
+            return _str.data() + pos;
+        }
+
+        /** Number of characters written through this sink. */
+        std::size_t size() const
+        {
+            return _str.size() - _start;
+        }
+
+        /** Discards characters written through this sink beyond the first `n`. */
+        void truncate(std::size_t n)
+        {
+            _str.resize(_start + n);
+        }
+
+    private:
+        std::basic_string<CharT>& _str;
+        std::size_t _start;
+    };
+
+    /**
+     * Writes output into a fixed-size buffer supplied by the caller.
+     *
+     * Writes that would not fit are discarded but still counted, such that `size()` reports the number of characters
+     * the buffer would need to hold the entire output.
+     */
+    template<typename CharT>
+    struct basic_span_sink
+    {
+        using char_type = CharT;
+
+        basic_span_sink(CharT* data, std::size_t capacity)
+            : _data(data), _capacity(capacity)
+        {
+        }
+
+        void push_back(CharT c)
+        {
+            if (_size < _capacity) {
+                _data[_size] = c;
+            }
+            ++_size;
+        }
+
+        void append(const CharT* s, std::size_t n)
+        {
+            if (n <= _capacity && _size <= _capacity - n) {
+                std::memcpy(_data + _size, s, n * sizeof(CharT));
+            }
+            _size += n;
+        }
+
+        /** Reserves `n` characters, and returns a pointer to the first of them, or null if they do not fit. */
+        CharT* extend(std::size_t n)
+        {
+            CharT* p = nullptr;
+            if (n <= _capacity && _size <= _capacity - n) {
+                p = _data + _size;
+            }
+            _size += n;
+            return p;
+        }
+
+        /** Number of characters written (or that would have been written) into the buffer. */
+        std::size_t size() const
+        {
+            return _size;
+        }
+
+        /** True if the output has not fit into the buffer. */
+        bool overflow() const
+        {
+            return _size > _capacity;
+        }
+
+        /** Discards characters beyond the first `n`. */
+        void truncate(std::size_t n)
+        {
+            _size = n;
+        }
+
+    private:
+        CharT* _data;
+        std::size_t _capacity;
+        std::size_t _size = 0;
+    };
+
+    using byte_string_sink = basic_string_sink<std::byte>;
+    using byte_span_sink = basic_span_sink<std::byte>;
+    using string_sink = basic_string_sink<char>;
+    using span_sink = basic_span_sink<char>;
+}
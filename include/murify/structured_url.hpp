@@ -0,0 +1,484 @@
+/**
+ * murify: Efficient in-memory compression for URLs
+ * @see https://github.com/hunyadi/murify
+ *
+ * Copyright (c) 2024 Levente Hunyadi
+ *
+ * This work is licensed under the terms of the MIT license.
+ * For a copy, see <https://opensource.org/licenses/MIT>.
+ */
+
+#pragma once
+#include "compactor.hpp"
+#include "concurrent_interned_store.hpp"
+#include "frozen_interned_store.hpp"
+#include "context_store.hpp"
+#include "sink.hpp"
+#include "detail/ip.hpp"
+#include "detail/strings.hpp"
+#include "detail/url.hpp"
+
+#include <string_view>
+#include <string>
+#include <array>
+#include <algorithm>
+#include <type_traits>
+#include <cstddef>
+#include <cstdint>
+
+namespace murify
+{
+    /**
+     * Lays out a URL as its components, each with its own encoding, rather than as a flat sequence of parts.
+     *
+     * The URL is split into scheme, authority (user information, host and port), path, query and fragment once, as
+     * specified in RFC 3986. Delimiters between components and separators within components are implied by the layout,
+     * and take no space:
+     *
+     * ```
+     * layout byte           flags for scheme, authority, user information, port, query and fragment
+     * scheme                index in a table of common schemes as a byte, or 0 followed by a part
+     * user information      part
+     * host                  public suffix and number of labels, followed by labels as parts (separated by `.`)
+     * port                  part
+     * path                  number of segments, followed by segments as parts (separated by `/`)
+     * query                 2 * number of pairs + 1 if all pairs have a value, followed by a bitmap of pairs that
+     *                       have a value unless all have, followed by keys and values as parts (separated by `&`
+     *                       and `=`)
+     * fragment              part
+     * ```
+     *
+     * Absent components take no space. Parts are encoded as with other tokenizers, i.e. with the encoding that
+     * suits their contents.
+     *
+     * Hosts are split into labels, which are interned individually, such that distinct subdomains of a domain share
+     * dictionary entries. A public suffix such as `com` or `co.uk` is identified by its index in a built-in table, and
+     * takes no dictionary entry. The host header byte holds the index of the public suffix (or 0) in its low 6 bits,
+     * and the number of labels in front of the suffix in its high 2 bits; the value 3 means the number of labels minus
+     * 3 follows as an integer. An IPv4 address, or an IPv6 address in brackets, is not split into labels: a header byte
+     * with all suffix bits set is followed by the address as a single part.
+     *
+     * If `Scoped` is set, path segments are interned in a dictionary scoped to the host, and query values in a
+     * dictionary scoped to the query key, e.g. values of `lang` or `sort`. Each context has an index space of its own,
+     * such that strings of a context with a small vocabulary take a single byte however large the dictionaries of all
+     * contexts grow. Other parts are interned in the store of the compactor.
+     */
+    template<bool Scoped>
+    struct BasicStructuredURLTokenizer : BaseTokenizer
+    {
+        constexpr static bool structured = true;
+
+        /** Dictionaries of path segments by host, and of query values by key. */
+        template<typename Store>
+        struct scoped_context_type
+        {
+            scoped_context_type() = default;
+
+            /** Takes a snapshot of the dictionaries of another compactor. */
+            template<typename Other>
+            explicit scoped_context_type(const scoped_context_type<Other>& other)
+                : segments(other.segments), values(other.values)
+            {
+            }
+
+            /** Adds the strings of the dictionaries of another compactor, in the order they were added. */
+            template<typename Other>
+            void merge(const scoped_context_type<Other>& other)
+            {
+                segments.merge(other.segments);
+                values.merge(other.values);
+            }
+
+            /** Invokes a function on each `context_store`, e.g. to save or load dictionaries. */
+            template<typename Fn>
+            void for_each(Fn&& fn) const
+            {
+                fn(segments);
+                fn(values);
+            }
+
+            /** Invokes a function on each `context_store`, e.g. to save or load dictionaries. */
+            template<typename Fn>
+            void for_each(Fn&& fn)
+            {
+                fn(segments);
+                fn(values);
+            }
+
+            context_store<Store> segments;
+            context_store<Store> values;
+        };
+
+        template<typename Store>
+        using context_type = std::conditional_t<Scoped, scoped_context_type<Store>, BaseTokenizer::context_type<Store>>;
+
+        /** An upper bound on the number of parts and component headers in the compact representation. */
+        static std::size_t count(const std::string_view& str)
+        {
+            return 8 + 2 * URLTokenizer::count(str) + static_cast<std::size_t>(std::count(str.begin(), str.end(), '.'));
+        }
+
+        template<typename Compactor, typename Output>
+        static void compact(Compactor& c, const std::string_view& str, Output& out);
+
+        template<typename Compactor, typename Output>
+        static void expand(Compactor& c, const std::basic_string_view<std::byte>& enc, Output& out);
+
+    private:
+        template<typename Compactor, typename Output>
+        static void compact_host(Compactor& c, const std::string_view& host, Output& out);
+
+        template<typename Compactor, typename Output>
+        static std::size_t expand_host(Compactor& c, const std::basic_string_view<std::byte>& enc, Output& out);
+
+        /** Parts interned in a dictionary scoped to a context. */
+        enum class scope
+        {
+            /** Path segments, scoped to the host. */
+            segments,
+            /** Query values, scoped to the key. */
+            values
+        };
+
+        /**
+         * Longest host or query key that identifies a dictionary of its own, which expansion keeps in a local buffer.
+         * Parts of longer contexts share the dictionary of the empty context.
+         */
+        constexpr static std::size_t max_context_size = 256;
+
+        static std::string_view scope_name(const std::string_view& context)
+        {
+            return context.size() <= max_context_size ? context : std::string_view();
+        }
+
+        /** The store to intern parts of a context in, which is the store of the compactor unless scoped. */
+        template<scope S, typename Compactor>
+        static decltype(auto) compact_scope(Compactor& c, const std::string_view& context)
+        {
+            if constexpr (!Scoped) {
+                return (c.string_store);
+            } else if constexpr (S == scope::segments) {
+                return c.context_stores.segments.scope(scope_name(context));
+            } else {
+                return c.context_stores.values.scope(scope_name(context));
+            }
+        }
+
+        /** The store to look up interned parts of a context in, which is the store of the compactor unless scoped. */
+        template<scope S, typename Compactor>
+        static decltype(auto) expand_scope(const Compactor& c, const std::string_view& context)
+        {
+            if constexpr (!Scoped) {
+                return (c.string_store);
+            } else if constexpr (S == scope::segments) {
+                return c.context_stores.segments.find(scope_name(context));
+            } else {
+                return c.context_stores.values.find(scope_name(context));
+            }
+        }
+
+        /** Bits of the host header byte that hold the index of the public suffix, or all set for an IP address. */
+        constexpr static unsigned int host_suffix_mask = 0x3f;
+
+        /** Number of labels in front of the public suffix from which the count is written as a separate integer. */
+        constexpr static unsigned int host_label_escape = 3;
+
+        static_assert(sizeof(detail::public_suffixes) / sizeof(detail::public_suffixes[0]) < host_suffix_mask,
+            "index of public suffix must fit into host header byte");
+
+        enum layout : unsigned int
+        {
+            has_scheme = 1u << 0,
+            has_authority = 1u << 1,
+            has_userinfo = 1u << 2,
+            has_port = 1u << 3,
+            has_query = 1u << 4,
+            has_fragment = 1u << 5
+        };
+    };
+
+    using StructuredURLTokenizer = BasicStructuredURLTokenizer<false>;
+
+    /** Lays out a URL as its components, with path segments scoped to the host and query values scoped to the key. */
+    using ScopedURLTokenizer = BasicStructuredURLTokenizer<true>;
+
+    struct StructuredURLCompactor : Compactor<StructuredURLTokenizer>
+    {
+        using Compactor::Compactor;
+    };
+
+    struct ConcurrentStructuredURLCompactor : Compactor<StructuredURLTokenizer, concurrent_interned_store>
+    {
+    };
+
+    struct FrozenStructuredURLCompactor : Compactor<StructuredURLTokenizer, frozen_interned_store>
+    {
+        using Compactor::Compactor;
+    };
+
+    struct ScopedURLCompactor : Compactor<ScopedURLTokenizer>
+    {
+        using Compactor::Compactor;
+    };
+
+    struct FrozenScopedURLCompactor : Compactor<ScopedURLTokenizer, frozen_interned_store>
+    {
+        using Compactor::Compactor;
+    };
+
+    template<bool Scoped>
+    template<typename Compactor, typename Output>
+    void BasicStructuredURLTokenizer<Scoped>::compact(Compactor& c, const std::string_view& str, Output& out)
+    {
+        detail::url_components url = detail::parse_url(str);
+
+        unsigned int flags = 0;
+        flags |= url.has_scheme ? has_scheme : 0u;
+        flags |= url.has_authority ? has_authority : 0u;
+        flags |= url.has_userinfo ? has_userinfo : 0u;
+        flags |= url.has_port ? has_port : 0u;
+        flags |= url.has_query ? has_query : 0u;
+        flags |= url.has_fragment ? has_fragment : 0u;
+        out.push_back(static_cast<std::byte>(flags));
+
+        if (url.has_scheme) {
+            unsigned int scheme = detail::find_url_scheme(url.scheme);
+            out.push_back(static_cast<std::byte>(scheme));
+            if (scheme == 0) {
+                c.compact_token(out, url.scheme);
+            }
+        }
+        if (url.has_userinfo) {
+            c.compact_token(out, url.userinfo);
+        }
+        if (url.has_authority) {
+            compact_host(c, url.host, out);
+        }
+        if (url.has_port) {
+            c.compact_token(out, url.port);
+        }
+
+        // an empty path has no segments, and a path of `/` has two empty segments
+        c.compact_integer(out, url.path.empty() ? 0 : detail::count_parts(url.path, '/'));
+        if (!url.path.empty()) {
+            auto&& strings = compact_scope<scope::segments>(c, url.host);
+            detail::for_each_part(url.path, '/', [&c, &out, &strings](const std::string_view& segment) {
+                c.compact_token(out, segment, true, strings);
+            });
+        }
+
+        if (url.has_query) {
+            // a single scan counts pairs, and pairs that have a key-value separator
+            constexpr detail::char_set separators("&=");
+            std::size_t pairs = 1;
+            std::size_t values = 0;
+            bool has_value = false;
+            separators.for_each_in(url.query, [&](std::size_t p) {
+                if (url.query[p] == '&') {
+                    values += has_value ? 1 : 0;
+                    has_value = false;
+                    ++pairs;
+                } else {
+                    has_value = true;
+                }
+            });
+            values += has_value ? 1 : 0;
+
+            c.compact_integer(out, 2 * pairs + (values == pairs ? 1 : 0));
+            if (values != pairs) {
+                // bitmap is complete before parts are written, which may move the output
+                std::byte* bitmap = out.extend((pairs + 7) / 8);
+                if (bitmap != nullptr) {
+                    std::fill_n(bitmap, (pairs + 7) / 8, std::byte{ 0 });
+                    std::size_t k = 0;
+                    detail::for_each_part(url.query, '&', [bitmap, &k](const std::string_view& pair) {
+                        if (pair.find('=') != std::string_view::npos) {
+                            bitmap[k / 8] |= static_cast<std::byte>(1u << (k % 8));
+                        }
+                        ++k;
+                    });
+                }
+            }
+            detail::for_each_part(url.query, '&', [&c, &out](const std::string_view& pair) {
+                std::size_t equals = pair.find('=');
+                if (equals != std::string_view::npos) {
+                    std::string_view key = pair.substr(0, equals);
+                    c.compact_token(out, key);
+                    auto&& strings = compact_scope<scope::values>(c, key);
+                    c.compact_token(out, pair.substr(equals + 1), true, strings);
+                } else {
+                    c.compact_token(out, pair);
+                }
+            });
+        }
+
+        if (url.has_fragment) {
+            c.compact_token(out, url.fragment);
+        }
+    }
+
+    template<bool Scoped>
+    template<typename Compactor, typename Output>
+    void BasicStructuredURLTokenizer<Scoped>::expand(Compactor& c, const std::basic_string_view<std::byte>& enc, Output& out)
+    {
+        std::size_t index = 0;
+        unsigned int flags = static_cast<unsigned int>(enc[index++]);
+
+        // host or query key that identifies the dictionary of the parts that follow, copied into a local buffer as it
+        // is written, or empty if it does not fit
+        [[maybe_unused]] std::array<char, max_context_size> context_buffer;
+        std::string_view context;
+        [[maybe_unused]] auto expand_context = [&out, &context_buffer, &context](auto&& expand) {
+            span_sink sink(context_buffer.data(), context_buffer.size());
+            std::size_t length = expand(sink);
+            if (sink.overflow()) {
+                context = std::string_view();
+                expand(out);
+            } else {
+                context = std::string_view(context_buffer.data(), sink.size());
+                out.append(context.data(), context.size());
+            }
+            return length;
+        };
+
+        if ((flags & has_scheme) != 0) {
+            unsigned int scheme = static_cast<unsigned int>(enc[index++]);
+            if (scheme != 0) {
+                std::string_view name = detail::url_schemes[scheme - 1];
+                out.append(name.data(), name.size());
+            } else {
+                index += c.expand_single(out, enc.substr(index));
+            }
+            out.push_back(':');
+        }
+        if ((flags & has_authority) != 0) {
+            out.append("//", 2);
+            if ((flags & has_userinfo) != 0) {
+                index += c.expand_single(out, enc.substr(index));
+                out.push_back('@');
+            }
+            if constexpr (Scoped) {
+                index += expand_context([&c, &enc, index](auto& sink) {
+                    return expand_host(c, enc.substr(index), sink);
+                });
+            } else {
+                index += expand_host(c, enc.substr(index), out);
+            }
+            if ((flags & has_port) != 0) {
+                out.push_back(':');
+                index += c.expand_single(out, enc.substr(index));
+            }
+        }
+
+        std::uint64_t segments;
+        index += Compactor::read_integer_token(segments, enc.substr(index));
+        if (segments > 0) {
+            auto&& strings = expand_scope<scope::segments>(c, context);
+            for (std::uint64_t k = 0; k < segments; ++k) {
+                if (k > 0) {
+                    out.push_back('/');
+                }
+                index += c.expand_single(out, enc.substr(index), strings);
+            }
+        }
+
+        if ((flags & has_query) != 0) {
+            out.push_back('?');
+            std::uint64_t header;
+            index += Compactor::read_integer_token(header, enc.substr(index));
+            std::size_t pairs = header >> 1;
+            const std::byte* bitmap = nullptr;
+            if ((header & 1) == 0) {
+                bitmap = enc.data() + index;
+                index += (pairs + 7) / 8;
+            }
+            for (std::size_t k = 0; k < pairs; ++k) {
+                if (k > 0) {
+                    out.push_back('&');
+                }
+                if constexpr (Scoped) {
+                    index += expand_context([&c, &enc, index](auto& sink) {
+                        return c.expand_single(sink, enc.substr(index));
+                    });
+                } else {
+                    index += c.expand_single(out, enc.substr(index));
+                }
+                if (bitmap == nullptr || (static_cast<unsigned int>(bitmap[k / 8]) & (1u << (k % 8))) != 0) {
+                    out.push_back('=');
+                    index += c.expand_single(out, enc.substr(index), expand_scope<scope::values>(c, context));
+                }
+            }
+        }
+
+        if ((flags & has_fragment) != 0) {
+            out.push_back('#');
+            index += c.expand_single(out, enc.substr(index));
+        }
+    }
+
+    template<bool Scoped>
+    template<typename Compactor, typename Output>
+    void BasicStructuredURLTokenizer<Scoped>::compact_host(Compactor& c, const std::string_view& host, Output& out)
+    {
+        // IP addresses are encapsulated as a whole
+        std::byte address[4];
+        if ((!host.empty() && host.front() == '[') || detail::parse_ipv4(host, address)) {
+            out.push_back(static_cast<std::byte>(host_suffix_mask));
+            c.compact_token(out, host);
+            return;
+        }
+
+        unsigned int suffix = detail::find_public_suffix(host);
+        std::string_view labels = host;
+        std::size_t count = host.empty() ? 0 : detail::count_parts(host, '.');
+        if (suffix != 0) {
+            // strip the suffix, and the dot in front of it unless the suffix is the entire host
+            std::size_t length = detail::public_suffixes[suffix - 1].size();
+            labels = host.substr(0, host.size() > length ? host.size() - length - 1 : 0);
+            count = host.size() > length ? detail::count_parts(labels, '.') : 0;
+        }
+
+        unsigned int escape = static_cast<unsigned int>(std::min<std::size_t>(count, host_label_escape));
+        out.push_back(static_cast<std::byte>((escape << 6) | suffix));
+        if (escape == host_label_escape) {
+            c.compact_integer(out, count - host_label_escape);
+        }
+        if (count > 0) {
+            detail::for_each_part(labels, '.', [&c, &out](const std::string_view& label) {
+                c.compact_token(out, label);
+            });
+        }
+    }
+
+    template<bool Scoped>
+    template<typename Compactor, typename Output>
+    std::size_t BasicStructuredURLTokenizer<Scoped>::expand_host(Compactor& c, const std::basic_string_view<std::byte>& enc, Output& out)
+    {
+        std::size_t index = 0;
+        unsigned int header = static_cast<unsigned int>(enc[index++]);
+        unsigned int suffix = header & host_suffix_mask;
+        if (suffix == host_suffix_mask) {
+            return index + c.expand_single(out, enc.substr(index));
+        }
+        std::uint64_t count = header >> 6;
+        if (count == host_label_escape) {
+            std::uint64_t extra;
+            index += Compactor::read_integer_token(extra, enc.substr(index));
+            count += extra;
+        }
+        for (std::uint64_t k = 0; k < count; ++k) {
+            if (k > 0) {
+                out.push_back('.');
+            }
+            index += c.expand_single(out, enc.substr(index));
+        }
+        if (suffix != 0) {
+            if (count > 0) {
+                out.push_back('.');
+            }
+            std::string_view name = detail::public_suffixes[suffix - 1];
+            out.append(name.data(), name.size());
+        }
+        return index;
+    }
+}
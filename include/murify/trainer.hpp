@@ -0,0 +1,207 @@
+/**
+ * murify: Efficient in-memory compression for URLs
+ * @see https://github.com/hunyadi/murify
+ *
+ * Copyright (c) 2024 Levente Hunyadi
+ *
+ * This work is licensed under the terms of the MIT license.
+ * For a copy, see <https://opensource.org/licenses/MIT>.
+ */
+
+#pragma once
+#include "compactor.hpp"
+#include "structured_url.hpp"
+#include "interned_string.hpp"
+#include "sink.hpp"
+
+#include <string_view>
+#include <string>
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <limits>
+#include <cstddef>
+#include <cstdint>
+
+namespace murify
+{
+    /**
+     * A store of interned strings that counts how many times each string is interned.
+     *
+     * Ordinals follow first-seen order, as with `interned_store`.
+     */
+    struct counting_store
+    {
+        /** Strings can be added to the store. */
+        constexpr static bool read_only = false;
+
+        counting_store() = default;
+
+        counting_store(const counting_store&) = delete;
+
+        std::string_view str(const interned_string& s) const
+        {
+            return _strings.str(s);
+        }
+
+        /** Number of times a string has been interned. */
+        std::uint64_t frequency(const interned_string& s) const
+        {
+            return _frequencies[s.index()];
+        }
+
+        using const_iterator = interned_store::const_iterator;
+
+        std::size_t count() const
+        {
+            return _strings.count();
+        }
+
+        const_iterator begin() const
+        {
+            return _strings.begin();
+        }
+
+        const_iterator end() const
+        {
+            return _strings.end();
+        }
+
+        void clear()
+        {
+            _strings.clear();
+            _frequencies.clear();
+        }
+
+        bool find(const std::string_view& str, interned_string& s) const
+        {
+            return _strings.find(str, s);
+        }
+
+        interned_string intern(const std::string_view& str)
+        {
+            interned_string s = _strings.intern(str);
+            if (s.index() == _frequencies.size()) {
+                _frequencies.push_back(0);
+            }
+            ++_frequencies[s.index()];
+            return s;
+        }
+
+    private:
+        interned_store _strings;
+        std::vector<std::uint64_t> _frequencies;
+    };
+
+    /**
+     * Builds a dictionary of interned strings from a sample corpus.
+     *
+     * Samples are compacted with the same tokenizer and the same token selection rules as `Compactor`, which counts
+     * exactly those tokens that would be interned. The dictionary lists tokens in order of decreasing frequency, such
+     * that the most frequent tokens get the smallest ordinals: the first 64 are embedded into the control byte, and
+     * the next 192 take a single byte. Tokens of equal frequency keep the order in which they were first seen, which
+     * makes training deterministic.
+     */
+    template<typename Tokenizer>
+    struct Trainer
+    {
+        /** Counts the tokens of a sample. */
+        void add(const std::string_view& str)
+        {
+            // compaction output is discarded, only the number of bytes is counted
+            std::byte discard[1];
+            byte_span_sink sink(discard, 0);
+            _samples_size += _compactor.compact_into(str, sink);
+            ++_sample_count;
+        }
+
+        /** Number of samples added. */
+        std::size_t sample_count() const
+        {
+            return _sample_count;
+        }
+
+        /** Number of bytes samples take when compacted with a dictionary built in first-seen order. */
+        std::size_t samples_size() const
+        {
+            return _samples_size;
+        }
+
+        /** Number of times a token has been seen as an interned string in the samples. */
+        std::uint64_t frequency(const std::string_view& str) const
+        {
+            interned_string s;
+            return _compactor.store().find(str, s) ? _compactor.store().frequency(s) : 0;
+        }
+
+        /**
+         * Ranks tokens in order of decreasing frequency.
+         *
+         * @param limit The maximum number of tokens to return.
+         * @param min_frequency Tokens seen fewer times are omitted.
+         */
+        std::vector<std::pair<std::string_view, std::uint64_t>> ranked(
+            std::size_t limit = std::numeric_limits<std::size_t>::max(),
+            std::uint64_t min_frequency = 1) const
+        {
+            const counting_store& store = _compactor.store();
+            std::vector<std::uint32_t> indices;
+            indices.reserve(store.count());
+            for (std::uint32_t k = 0; k < store.count(); ++k) {
+                if (store.frequency(interned_string(k)) >= min_frequency) {
+                    indices.push_back(k);
+                }
+            }
+
+            // ties are resolved in first-seen order
+            std::stable_sort(indices.begin(), indices.end(), [&store](std::uint32_t a, std::uint32_t b) {
+                return store.frequency(interned_string(a)) > store.frequency(interned_string(b));
+            });
+            if (indices.size() > limit) {
+                indices.resize(limit);
+            }
+
+            std::vector<std::pair<std::string_view, std::uint64_t>> result;
+            result.reserve(indices.size());
+            for (std::uint32_t k : indices) {
+                result.emplace_back(store.str(interned_string(k)), store.frequency(interned_string(k)));
+            }
+            return result;
+        }
+
+        /**
+         * Adds ranked tokens to a store, such that the most frequent tokens get the smallest ordinals.
+         *
+         * The store is expected to be empty; tokens already in the store keep their ordinals.
+         */
+        template<typename Store>
+        void seed(Store& store,
+            std::size_t limit = std::numeric_limits<std::size_t>::max(),
+            std::uint64_t min_frequency = 1) const
+        {
+            for (auto&& item : ranked(limit, min_frequency)) {
+                store.intern(item.first);
+            }
+        }
+
+        /** Builds a store pre-seeded with ranked tokens. */
+        interned_store build(
+            std::size_t limit = std::numeric_limits<std::size_t>::max(),
+            std::uint64_t min_frequency = 1) const
+        {
+            interned_store store;
+            seed(store, limit, min_frequency);
+            return store;
+        }
+
+    private:
+        Compactor<Tokenizer, counting_store> _compactor;
+        std::size_t _sample_count = 0;
+        std::size_t _samples_size = 0;
+    };
+
+    using PathTrainer = Trainer<PathTokenizer>;
+    using QueryTrainer = Trainer<QueryTokenizer>;
+    using URLTrainer = Trainer<URLTokenizer>;
+    using StructuredURLTrainer = Trainer<StructuredURLTokenizer>;
+}
@@ -0,0 +1,95 @@
+/**
+ * murify: Efficient in-memory compression for URLs
+ * @see https://github.com/hunyadi/murify
+ *
+ * Copyright (c) 2024 Levente Hunyadi
+ *
+ * This work is licensed under the terms of the MIT license.
+ * For a copy, see <https://opensource.org/licenses/MIT>.
+ */
+
+#include <murify/detail/builtin_dictionary.hpp>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+/**
+ * Finds a perfect hash of the built-in tokens, and prints the seed and slot tables of `murify::detail::builtin_table`.
+ *
+ * Tokens are distributed into buckets by their hash. Buckets with more tokens are harder to place, and go first:
+ * each bucket gets the smallest seed such that all tokens in the bucket map to distinct free slots when the seed is
+ * mixed into their hash. Run after changing `builtin_tokens`, and paste the output into `builtin_dictionary.hpp`.
+ *
+ * Usage: murify-builtin-table
+ */
+
+using murify::detail::builtin_table;
+using murify::detail::builtin_token_count;
+using murify::detail::builtin_tokens;
+
+/** Finds a seed that places all tokens of a bucket into free slots. */
+static bool place(const std::vector<std::uint64_t>& hashes, std::size_t b, std::vector<std::uint16_t>& seeds, std::vector<std::uint16_t>& slots)
+{
+    std::vector<std::size_t> chosen;
+    for (std::uint32_t seed = 0; seed <= UINT16_MAX; ++seed) {
+        chosen.clear();
+        bool free = true;
+        for (std::size_t k = 0; k < builtin_token_count && free; ++k) {
+            if (builtin_table::bucket(hashes[k]) != b) {
+                continue;
+            }
+            std::size_t s = builtin_table::slot(hashes[k], static_cast<std::uint16_t>(seed));
+            free = slots[s] == 0;
+            for (std::size_t i = 0; i < chosen.size() && free; ++i) {
+                free = s != chosen[i];
+            }
+            chosen.push_back(s);
+        }
+        if (free) {
+            seeds[b] = static_cast<std::uint16_t>(seed);
+            for (std::size_t k = 0, i = 0; k < builtin_token_count; ++k) {
+                if (builtin_table::bucket(hashes[k]) == b) {
+                    slots[chosen[i++]] = static_cast<std::uint16_t>(k + 1);
+                }
+            }
+            return true;
+        }
+    }
+    return false;
+}
+
+static void print(const char* name, const char* doc, const std::vector<std::uint16_t>& values, const char* size)
+{
+    std::cout << "            /** " << doc << " */" << std::endl;
+    std::cout << "            constexpr static std::uint16_t " << name << "[" << size << "] = {";
+    for (std::size_t k = 0; k < values.size(); ++k) {
+        std::cout << (k % 16 == 0 ? "\n                " : " ") << values[k] << (k + 1 < values.size() ? "," : "");
+    }
+    std::cout << std::endl << "            };" << std::endl;
+}
+
+int main(int /*argc*/, char* /*argv*/[])
+{
+    std::vector<std::uint64_t> hashes(builtin_token_count);
+    std::vector<std::size_t> sizes(builtin_table::bucket_count);
+    for (std::size_t k = 0; k < builtin_token_count; ++k) {
+        hashes[k] = builtin_table::hash(builtin_tokens[k]);
+        ++sizes[builtin_table::bucket(hashes[k])];
+    }
+
+    std::vector<std::uint16_t> seeds(builtin_table::bucket_count);
+    std::vector<std::uint16_t> slots(builtin_table::slot_count);
+    for (std::size_t size = builtin_token_count; size > 0; --size) {
+        for (std::size_t b = 0; b < builtin_table::bucket_count; ++b) {
+            if (sizes[b] == size && !place(hashes, b, seeds, slots)) {
+                std::cerr << "error: no seed places all built-in tokens in bucket " << b << std::endl;
+                return EXIT_FAILURE;
+            }
+        }
+    }
+
+    print("seeds", "Seed of each bucket.", seeds, "bucket_count");
+    print("slots", "One more than the index of the token in each slot, or 0 for a free slot.", slots, "slot_count");
+    return EXIT_SUCCESS;
+}
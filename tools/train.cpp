@@ -0,0 +1,110 @@
+/**
+ * murify: Efficient in-memory compression for URLs
+ * @see https://github.com/hunyadi/murify
+ *
+ * Copyright (c) 2024 Levente Hunyadi
+ *
+ * This work is licensed under the terms of the MIT license.
+ * For a copy, see <https://opensource.org/licenses/MIT>.
+ */
+
+#include <murify/trainer.hpp>
+#include <murify/dictionary_file.hpp>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <vector>
+
+/**
+ * Builds a dictionary of interned strings from a sample corpus with one URL (or path or query string) per line.
+ *
+ * The dictionary is written as a binary file that `murify::load_dictionary` maps into memory, and which a
+ * `FrozenPathCompactor`, `FrozenQueryCompactor`, `FrozenURLCompactor` or `FrozenStructuredURLCompactor` uses directly.
+ *
+ * Usage: murify-train <path|query|url|structured> <corpus> [dictionary] [limit]
+ */
+
+template<typename Tokenizer>
+static int train(const std::vector<std::string>& samples, const char* dictionary_path, std::size_t limit)
+{
+    murify::Trainer<Tokenizer> trainer;
+    for (auto&& sample : samples) {
+        trainer.add(sample);
+    }
+
+    auto ranked = trainer.ranked(limit);
+    murify::Compactor<Tokenizer> compactor(trainer.build(limit));
+    std::size_t trained_size = 0;
+    for (auto&& sample : samples) {
+        trained_size += compactor.compact(sample).size();
+    }
+
+    std::size_t sample_size = 0;
+    for (auto&& sample : samples) {
+        sample_size += sample.size();
+    }
+
+    std::cout << "samples: " << trainer.sample_count() << std::endl;
+    std::cout << "tokens: " << ranked.size() << std::endl;
+    std::cout << "original size: " << sample_size << std::endl;
+    std::cout << "compact size (first-seen order): " << trainer.samples_size() << std::endl;
+    std::cout << "compact size (trained order): " << trained_size << std::endl;
+    if (!samples.empty()) {
+        std::cout << "saving per sample: " << (static_cast<double>(trainer.samples_size()) - static_cast<double>(trained_size)) / samples.size() << std::endl;
+    }
+
+    std::cout << std::endl << "rank\tfrequency\ttoken" << std::endl;
+    for (std::size_t k = 0; k < ranked.size() && k < 64; ++k) {
+        std::cout << k << '\t' << ranked[k].second << '\t' << ranked[k].first << std::endl;
+    }
+
+    if (dictionary_path != nullptr) {
+        try {
+            murify::save_dictionary(dictionary_path, trainer.build(limit));
+        } catch (std::exception& e) {
+            std::cerr << "error: " << e.what() << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+    return EXIT_SUCCESS;
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc < 3) {
+        std::cerr << "usage: murify-train <path|query|url|structured> <corpus> [dictionary] [limit]" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::ifstream in(argv[2], std::ios::binary);
+    if (!in) {
+        std::cerr << "error: cannot read corpus: " << argv[2] << std::endl;
+        return EXIT_FAILURE;
+    }
+    std::vector<std::string> samples;
+    std::string line;
+    while (std::getline(in, line)) {
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+        samples.push_back(line);
+    }
+
+    const char* dictionary_path = argc > 3 ? argv[3] : nullptr;
+    std::size_t limit = argc > 4 ? std::strtoul(argv[4], nullptr, 10) : std::numeric_limits<std::size_t>::max();
+    if (std::strcmp(argv[1], "path") == 0) {
+        return train<murify::PathTokenizer>(samples, dictionary_path, limit);
+    } else if (std::strcmp(argv[1], "query") == 0) {
+        return train<murify::QueryTokenizer>(samples, dictionary_path, limit);
+    } else if (std::strcmp(argv[1], "url") == 0) {
+        return train<murify::URLTokenizer>(samples, dictionary_path, limit);
+    } else if (std::strcmp(argv[1], "structured") == 0) {
+        return train<murify::StructuredURLTokenizer>(samples, dictionary_path, limit);
+    } else {
+        std::cerr << "error: unknown mode: " << argv[1] << std::endl;
+        return EXIT_FAILURE;
+    }
+}